@@ -0,0 +1,219 @@
+// chain_source_bench.cpp
+// 在 5MB、32KB 一块的 IOBuf 链上对比两种读取方式：
+//   legacy : 原先 IOBufWarp + iobuf_mpg123_read 的做法，每次拷贝前从链首走到当前位置（updateCurrentIOBuf）
+//   chain  : ChainSource，游标在追加后依然有效，seek 在块索引上二分查找
+// 场景：整段顺序读取、随机 seek 后读取、边追加边读（模拟下载中解码）。
+//
+// 用法：chain_source_bench [read_size] [repeat]
+#include "../src/DownloadManager/utils/ByteSource.h"
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    constexpr size_t BLOCK_SIZE = 32 * 1024;
+    constexpr size_t TOTAL_SIZE = 5 * 1024 * 1024;
+    constexpr size_t RANDOM_READS = 10000;
+
+    // 原先的读取方式，逻辑与 iobuf_mpg123_read / updateCurrentIOBuf 相同（去掉了日志）
+    struct LegacyReader {
+        folly::IOBufQueue *queue;
+        const folly::IOBuf *current = nullptr;
+        size_t offset = 0;
+        size_t pos = 0;
+
+        [[nodiscard]] size_t size() const { return queue->chainLength(); }
+
+        void update_current() {
+            size_t accumulated = 0;
+            current = queue->front();
+            while (current) {
+                size_t length = current->length();
+                if (accumulated + length > pos) {
+                    offset = pos - accumulated;
+                    return;
+                }
+                accumulated += length;
+                current = current->next();
+            }
+            current = nullptr;
+            offset = 0;
+        }
+
+        size_t read(void *buffer, size_t size_wanted) {
+            size_t copied = 0;
+            while (copied < size_wanted) {
+                if (pos >= size()) {
+                    break;
+                }
+                update_current();
+                if (!current) {
+                    break;
+                }
+                size_t to_copy = std::min(size_wanted - copied, current->length() - offset);
+                std::memcpy(static_cast<uint8_t *>(buffer) + copied, current->data() + offset, to_copy);
+                copied += to_copy;
+                pos += to_copy;
+                offset += to_copy;
+                if (offset >= current->length()) {
+                    current = current->next();
+                    offset = 0;
+                }
+            }
+            return copied;
+        }
+
+        bool seek(size_t target) {
+            if (target > size()) {
+                return false;
+            }
+            pos = target;
+            update_current();
+            return true;
+        }
+    };
+
+    std::unique_ptr<folly::IOBuf> make_block(size_t index) {
+        auto block = folly::IOBuf::create(BLOCK_SIZE);
+        std::memset(block->writableData(), static_cast<int>(index & 0xff), BLOCK_SIZE);
+        block->append(BLOCK_SIZE);
+        return block;
+    }
+
+    void fill(folly::IOBufQueue &queue, size_t blocks) {
+        for (size_t i = 0; i < blocks; ++i) {
+            queue.append(make_block(i));
+        }
+    }
+
+    uint64_t checksum(const uint8_t *data, size_t size) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < size; i += 512) {
+            sum += data[i];
+        }
+        return sum;
+    }
+
+    // prepare 不计时，用于准备每一轮要追加的数据块
+    template<typename Prepare, typename Fn>
+    double best_of(int repeat, Prepare &&prepare, Fn &&fn) {
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < repeat; ++i) {
+            prepare();
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    template<typename Fn>
+    double best_of(int repeat, Fn &&fn) {
+        return best_of(repeat, [] {}, std::forward<Fn>(fn));
+    }
+
+    void report(const char *scenario, const char *name, double seconds, size_t operations, size_t bytes) {
+        std::cout << scenario << " " << name << ": " << seconds * 1000.0 << " ms, "
+                  << seconds * 1e9 / static_cast<double>(operations) << " ns/read, "
+                  << static_cast<double>(bytes) / seconds / (1024.0 * 1024.0) << " MiB/s" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    const size_t read_size = argc > 1 ? std::max<size_t>(1, std::strtoul(argv[1], nullptr, 10)) : 4096;
+    const int repeat = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    const size_t blocks = TOTAL_SIZE / BLOCK_SIZE;
+    std::vector<uint8_t> buffer(read_size);
+    uint64_t sink = 0;
+
+    std::cout << blocks << " blocks x " << BLOCK_SIZE / 1024 << " KiB, read size " << read_size << ", best of "
+              << repeat << " runs" << std::endl;
+
+    folly::IOBufQueue full{folly::IOBufQueue::cacheChainLength()};
+    fill(full, blocks);
+    const size_t sequential_reads = (TOTAL_SIZE + read_size - 1) / read_size;
+
+    // 1. 整段顺序读取
+    double legacy_seq = best_of(repeat, [&] {
+        LegacyReader reader{&full};
+        while (size_t got = reader.read(buffer.data(), read_size)) {
+            sink += checksum(buffer.data(), got);
+        }
+    });
+    double chain_seq = best_of(repeat, [&] {
+        ChainSource source(&full);
+        while (size_t got = source.read_into(buffer.data(), read_size)) {
+            sink += checksum(buffer.data(), got);
+        }
+    });
+    report("sequential", "legacy", legacy_seq, sequential_reads, TOTAL_SIZE);
+    report("sequential", "chain ", chain_seq, sequential_reads, TOTAL_SIZE);
+
+    // 2. 随机 seek 后读取，两种方式使用同一组位置
+    std::mt19937_64 rng(42);
+    std::vector<size_t> positions(RANDOM_READS);
+    for (auto &position: positions) {
+        position = static_cast<size_t>(rng() % (TOTAL_SIZE - read_size));
+    }
+    double legacy_random = best_of(repeat, [&] {
+        LegacyReader reader{&full};
+        for (size_t position: positions) {
+            reader.seek(position);
+            sink += checksum(buffer.data(), reader.read(buffer.data(), read_size));
+        }
+    });
+    double chain_random = best_of(repeat, [&] {
+        ChainSource source(&full);
+        for (size_t position: positions) {
+            source.seek(position);
+            sink += checksum(buffer.data(), source.read_into(buffer.data(), read_size));
+        }
+    });
+    report("random    ", "legacy", legacy_random, RANDOM_READS, RANDOM_READS * read_size);
+    report("random    ", "chain ", chain_random, RANDOM_READS, RANDOM_READS * read_size);
+
+    // 3. 每追加一块就把已有数据读完，读取器在整个过程中保持不变；数据块的分配不计时
+    std::vector<std::unique_ptr<folly::IOBuf>> pending(blocks);
+    auto prepare = [&] {
+        for (size_t i = 0; i < blocks; ++i) {
+            pending[i] = make_block(i);
+        }
+    };
+    double legacy_stream = best_of(repeat, prepare, [&] {
+        folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+        LegacyReader reader{&queue};
+        for (size_t i = 0; i < blocks; ++i) {
+            queue.append(std::move(pending[i]));
+            while (size_t got = reader.read(buffer.data(), read_size)) {
+                sink += checksum(buffer.data(), got);
+            }
+        }
+    });
+    double chain_stream = best_of(repeat, prepare, [&] {
+        folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+        ChainSource source(&queue);
+        for (size_t i = 0; i < blocks; ++i) {
+            queue.append(std::move(pending[i]));
+            while (size_t got = source.read_into(buffer.data(), read_size)) {
+                sink += checksum(buffer.data(), got);
+            }
+        }
+    });
+    report("streaming ", "legacy", legacy_stream, sequential_reads, TOTAL_SIZE);
+    report("streaming ", "chain ", chain_stream, sequential_reads, TOTAL_SIZE);
+
+    // 防止读取结果被优化掉
+    std::cout << "checksum " << sink << std::endl;
+    return 0;
+}
@@ -0,0 +1,219 @@
+// ffmpeg_decode_bench.cpp
+// FLAC / AAC（或任意 FFmpeg 支持的文件）整段在内存中时的解封装与解码吞吐量，
+// 按 AVIO 缓冲区大小（avio_buffer_size）与 AVIOContext::direct 开关分别测量。
+// 读写回调与 FfmpegDecoder 相同：CustomIO::source_read / source_seek 包装一个已完成的 MemorySource。
+//   demux  : 只 av_read_frame，反映 AVIO 回调与拷贝的开销
+//   decode : 解封装并解码全部音频帧
+//
+// 用法：ffmpeg_decode_bench <file> [file...] [-r repeat]
+#include "../src/DownloadManager/AudioSender/decoder/CustomIO.hpp"
+#include "../src/DownloadManager/utils/ByteSource.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavcodec/avcodec.h>
+#include <libavutil/frame.h>
+}
+
+namespace {
+    constexpr int BUFFER_SIZES[] = {4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024};
+
+    // 在 CustomIO 回调外面计数，数据源仍然是 FfmpegDecoder 使用的 ByteSource
+    struct CountingSource {
+        MemorySource source;
+        size_t reads = 0;
+        size_t seeks = 0;
+
+        CountingSource(const uint8_t *data, size_t length) : source(data, length) {}
+
+        static int read(void *opaque, uint8_t *buf, int buf_size) {
+            auto *self = static_cast<CountingSource *>(opaque);
+            self->reads++;
+            return CustomIO::source_read(&self->source, buf, buf_size);
+        }
+
+        static int64_t seek(void *opaque, int64_t offset, int whence) {
+            auto *self = static_cast<CountingSource *>(opaque);
+            if (whence != AVSEEK_SIZE) {
+                self->seeks++;
+            }
+            return CustomIO::source_seek(&self->source, offset, whence);
+        }
+    };
+
+    struct RunResult {
+        bool ok = false;
+        double seconds = 0;
+        int64_t samples = 0; // 每声道样本数
+        int sample_rate = 0;
+        size_t reads = 0;
+        size_t seeks = 0;
+        std::string codec;
+    };
+
+    std::vector<uint8_t> read_file(const char *path) {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    // 与 FfmpegDecoder::initialize_decoder 相同的打开方式，计时包含打开、探测与全部读取
+    RunResult run(const std::vector<uint8_t> &data, int buffer_size, bool direct, bool decode) {
+        RunResult result;
+        CountingSource counting(data.data(), data.size());
+        AVFormatContext *format_ctx = nullptr;
+        AVCodecContext *codec_ctx = nullptr;
+        AVPacket *packet = av_packet_alloc();
+        AVFrame *frame = av_frame_alloc();
+
+        auto start = std::chrono::steady_clock::now();
+        auto *buffer = static_cast<unsigned char *>(av_malloc(buffer_size));
+        AVIOContext *avio_ctx = avio_alloc_context(buffer, buffer_size, 0, &counting, CountingSource::read, nullptr,
+                                                   CountingSource::seek);
+        if (!avio_ctx) {
+            av_free(buffer);
+            av_frame_free(&frame);
+            av_packet_free(&packet);
+            return result;
+        }
+        avio_ctx->direct = direct ? 1 : 0;
+
+        int stream_index = -1;
+        format_ctx = avformat_alloc_context();
+        format_ctx->pb = avio_ctx;
+        format_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+        if (avformat_open_input(&format_ctx, nullptr, nullptr, nullptr) < 0) {
+            std::cerr << "avformat_open_input failed" << std::endl;
+            format_ctx = nullptr;
+        } else if (avformat_find_stream_info(format_ctx, nullptr) < 0) {
+            std::cerr << "avformat_find_stream_info failed" << std::endl;
+        } else {
+            const AVCodec *codec = nullptr;
+            stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+            if (stream_index >= 0 && codec) {
+                result.codec = codec->name;
+                codec_ctx = avcodec_alloc_context3(codec);
+                if (avcodec_parameters_to_context(codec_ctx, format_ctx->streams[stream_index]->codecpar) < 0 ||
+                    avcodec_open2(codec_ctx, codec, nullptr) < 0) {
+                    std::cerr << "failed to open decoder " << codec->name << std::endl;
+                    stream_index = -1;
+                }
+            }
+        }
+
+        if (stream_index >= 0) {
+            result.ok = true;
+            result.sample_rate = codec_ctx->sample_rate;
+            while (av_read_frame(format_ctx, packet) >= 0) {
+                if (decode && packet->stream_index == stream_index && avcodec_send_packet(codec_ctx, packet) == 0) {
+                    while (avcodec_receive_frame(codec_ctx, frame) == 0) {
+                        result.samples += frame->nb_samples;
+                    }
+                }
+                av_packet_unref(packet);
+            }
+            if (!decode) {
+                // 只解封装时按容器给出的时长折算
+                if (format_ctx->duration > 0) {
+                    result.samples = av_rescale(format_ctx->duration, result.sample_rate, AV_TIME_BASE);
+                }
+            } else {
+                avcodec_send_packet(codec_ctx, nullptr);
+                while (avcodec_receive_frame(codec_ctx, frame) == 0) {
+                    result.samples += frame->nb_samples;
+                }
+            }
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.seconds = elapsed.count();
+        result.reads = counting.reads;
+        result.seeks = counting.seeks;
+
+        avcodec_free_context(&codec_ctx);
+        avformat_close_input(&format_ctx);
+        // 自定义 IO 的 AVIOContext 与缓冲区由调用方释放，缓冲区可能已被 FFmpeg 换过
+        av_freep(&avio_ctx->buffer);
+        avio_context_free(&avio_ctx);
+        av_frame_free(&frame);
+        av_packet_free(&packet);
+        return result;
+    }
+
+    RunResult best_of(int repeat, const std::vector<uint8_t> &data, int buffer_size, bool direct, bool decode) {
+        RunResult best;
+        best.seconds = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < repeat; ++i) {
+            RunResult result = run(data, buffer_size, direct, decode);
+            if (!result.ok) {
+                return result;
+            }
+            if (result.seconds < best.seconds) {
+                best = result;
+            }
+        }
+        return best;
+    }
+
+    void report(const char *mode, int buffer_size, bool direct, size_t input_bytes, const RunResult &result) {
+        double audio_seconds = result.sample_rate > 0 ? static_cast<double>(result.samples) / result.sample_rate : 0;
+        std::cout << "  " << mode << " buffer " << buffer_size / 1024 << " KiB" << (direct ? " direct" : "       ")
+                  << ": " << result.seconds * 1000.0 << " ms, "
+                  << static_cast<double>(input_bytes) / result.seconds / (1024.0 * 1024.0) << " MiB/s input, "
+                  << audio_seconds / result.seconds << "x realtime, " << result.reads << " reads, "
+                  << result.seeks << " seeks" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int repeat = 5;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        std::cerr << "usage: " << argv[0] << " <file> [file...] [-r repeat]" << std::endl;
+        return 1;
+    }
+    av_log_set_level(AV_LOG_ERROR);
+
+    for (const char *path: files) {
+        auto data = read_file(path);
+        if (data.empty()) {
+            std::cerr << "failed to read " << path << std::endl;
+            continue;
+        }
+        std::cout << path << " (" << data.size() / 1024 << " KiB), best of " << repeat << " runs" << std::endl;
+        bool printed_codec = false;
+        for (bool decode: {false, true}) {
+            for (int buffer_size: BUFFER_SIZES) {
+                for (bool direct: {false, true}) {
+                    RunResult result = best_of(repeat, data, buffer_size, direct, decode);
+                    if (!result.ok) {
+                        std::cerr << "  failed to open " << path << std::endl;
+                        return 1;
+                    }
+                    if (!printed_codec) {
+                        std::cout << "  codec " << result.codec << ", " << result.sample_rate << " Hz" << std::endl;
+                        printed_codec = true;
+                    }
+                    report(decode ? "decode" : "demux ", buffer_size, direct, data.size(), result);
+                }
+            }
+        }
+    }
+    return 0;
+}
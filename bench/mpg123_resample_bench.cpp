@@ -0,0 +1,300 @@
+// mpg123_resample_bench.cpp
+// 对比 MP3 转成 48kHz 立体声 S16 的两条路径：
+//   fixed : mpg123 固定输出 48kHz S16（MPG123_FORCE_RATE，内部 NtoM 重采样），即 mpg123_fixed_output = true
+//   src   : mpg123 按原始采样率输出 S16，转 float 后逐块 src_simple(SRC_SINC_FASTEST) 再转回 S16，即原先的 libsamplerate 路径
+// 质量以整段 SRC_SINC_BEST_QUALITY 重采样的结果为参考，报告对齐后的信噪比；耗时为解码 + 重采样的线程 CPU 时间。
+// 两条路径都强制立体声输出，便于逐样本比较。48kHz 的文件两条路径都不重采样，应使用 44.1kHz、32kHz 等文件。
+//
+// 用法：mpg123_resample_bench <file.mp3> [repeat]
+#include <mpg123.h>
+#include <samplerate.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+namespace {
+    constexpr long TARGET_RATE = 48000;
+    constexpr int CHANNELS = 2;
+    constexpr size_t READ_SIZE = 73728; // 与 AudioSender::MAX_DECODE_SIZE 一致，src 路径按这个粒度逐块重采样
+    constexpr int MAX_LAG = 256;         // 对齐时搜索的最大偏移（帧）
+
+    struct RunResult {
+        std::vector<float> samples; // 交错立体声，[-1, 1]
+        long source_rate = 0;
+        double cpu_seconds = 0;
+    };
+
+    std::vector<uint8_t> read_file(const char *path) {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    double thread_cpu_seconds() {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+    }
+
+    // 与 Mpg123Decoder 构造函数的设置一致：fixed 对应 mpg123_fixed_output = true
+    mpg123_handle *open_decoder(bool fixed) {
+        int err = MPG123_OK;
+        mpg123_handle *mh = mpg123_new(nullptr, &err);
+        if (!mh) {
+            std::cerr << "mpg123_new failed: " << mpg123_plain_strerror(err) << std::endl;
+            return nullptr;
+        }
+        mpg123_param2(mh, MPG123_ADD_FLAGS, MPG123_SEEKBUFFER | MPG123_FORCE_STEREO, 0.0);
+        mpg123_format_none(mh);
+        if (fixed) {
+            mpg123_param2(mh, MPG123_FORCE_RATE, TARGET_RATE, 0.0);
+            if (mpg123_format(mh, TARGET_RATE, MPG123_STEREO, MPG123_ENC_SIGNED_16) != MPG123_OK) {
+                std::cerr << "mpg123 rejected the fixed output format: " << mpg123_strerror(mh) << std::endl;
+                mpg123_delete(mh);
+                return nullptr;
+            }
+        } else {
+            mpg123_format_all(mh);
+        }
+        if (mpg123_open_feed(mh) != MPG123_OK) {
+            std::cerr << "mpg123_open_feed failed: " << mpg123_strerror(mh) << std::endl;
+            mpg123_delete(mh);
+            return nullptr;
+        }
+        return mh;
+    }
+
+    // 整段喂入后按 READ_SIZE 逐块读出，每块 S16 交错数据交给 sink(pcm, samples, rate)
+    template<typename Sink>
+    bool decode(bool fixed, const std::vector<uint8_t> &data, Sink &&sink) {
+        mpg123_handle *mh = open_decoder(fixed);
+        if (!mh) {
+            return false;
+        }
+        std::vector<unsigned char> buffer(READ_SIZE);
+        bool ok = mpg123_feed(mh, data.data(), data.size()) == MPG123_OK;
+        long rate = 0;
+        while (ok) {
+            size_t done = 0;
+            int ret = mpg123_read(mh, buffer.data(), buffer.size(), &done);
+            if (ret == MPG123_NEW_FORMAT) {
+                int channels = 0;
+                int encoding = 0;
+                mpg123_getformat(mh, &rate, &channels, &encoding);
+                if (channels != CHANNELS || encoding != MPG123_ENC_SIGNED_16) {
+                    std::cerr << "unexpected output format: channels=" << channels << " encoding=" << encoding
+                              << std::endl;
+                    ok = false;
+                }
+                continue;
+            }
+            if (done > 0) {
+                sink(reinterpret_cast<const int16_t *>(buffer.data()), done / sizeof(int16_t), rate);
+            }
+            if (ret == MPG123_NEED_MORE || ret == MPG123_DONE) {
+                break;
+            }
+            if (ret != MPG123_OK) {
+                std::cerr << "mpg123_read failed: " << mpg123_strerror(mh) << std::endl;
+                ok = false;
+            }
+        }
+        mpg123_close(mh);
+        mpg123_delete(mh);
+        return ok;
+    }
+
+    float s16_to_float(int16_t sample) { return static_cast<float>(sample) / 32768.0f; }
+
+    int16_t float_to_s16(float sample) {
+        float scaled = std::clamp(sample * 32768.0f, -32768.0f, 32767.0f);
+        return static_cast<int16_t>(std::lrint(scaled));
+    }
+
+    // mpg123 直接输出 48kHz，不再经过 libsamplerate
+    bool run_fixed(const std::vector<uint8_t> &data, RunResult &result) {
+        std::vector<int16_t> out;
+        double start = thread_cpu_seconds();
+        bool ok = decode(true, data, [&out](const int16_t *pcm, size_t samples, long) {
+            out.insert(out.end(), pcm, pcm + samples);
+        });
+        result.cpu_seconds = thread_cpu_seconds() - start;
+        result.samples.resize(out.size());
+        std::transform(out.begin(), out.end(), result.samples.begin(), s16_to_float);
+        return ok;
+    }
+
+    // 与 AudioSender::resample_audio 相同：每块独立调用 src_simple，不保留块间状态
+    bool run_src(const std::vector<uint8_t> &data, RunResult &result) {
+        std::vector<int16_t> out;
+        std::vector<float> in_float;
+        std::vector<float> out_float;
+        bool resample_ok = true;
+        double start = thread_cpu_seconds();
+        bool ok = decode(false, data, [&](const int16_t *pcm, size_t samples, long rate) {
+            result.source_rate = rate;
+            if (rate == TARGET_RATE) {
+                out.insert(out.end(), pcm, pcm + samples);
+                return;
+            }
+            in_float.resize(samples);
+            std::transform(pcm, pcm + samples, in_float.begin(), s16_to_float);
+            SRC_DATA src_data{};
+            src_data.data_in = in_float.data();
+            src_data.input_frames = static_cast<long>(samples / CHANNELS);
+            src_data.src_ratio = static_cast<double>(TARGET_RATE) / static_cast<double>(rate);
+            src_data.output_frames = static_cast<long>(static_cast<double>(src_data.input_frames) * src_data.src_ratio) + 1;
+            out_float.resize(static_cast<size_t>(src_data.output_frames) * CHANNELS);
+            src_data.data_out = out_float.data();
+            if (src_simple(&src_data, SRC_SINC_FASTEST, CHANNELS) != 0) {
+                resample_ok = false;
+                return;
+            }
+            size_t produced = static_cast<size_t>(src_data.output_frames_gen) * CHANNELS;
+            std::transform(out_float.begin(), out_float.begin() + static_cast<long>(produced), std::back_inserter(out),
+                           float_to_s16);
+        });
+        result.cpu_seconds = thread_cpu_seconds() - start;
+        result.samples.resize(out.size());
+        std::transform(out.begin(), out.end(), result.samples.begin(), s16_to_float);
+        return ok && resample_ok;
+    }
+
+    // 参考：整段原始采样率的数据一次性用最高质量重采样
+    bool run_reference(const std::vector<uint8_t> &data, RunResult &result) {
+        std::vector<float> native;
+        bool ok = decode(false, data, [&](const int16_t *pcm, size_t samples, long rate) {
+            result.source_rate = rate;
+            std::transform(pcm, pcm + samples, std::back_inserter(native), s16_to_float);
+        });
+        if (!ok || result.source_rate == 0) {
+            return false;
+        }
+        if (result.source_rate == TARGET_RATE) {
+            result.samples = std::move(native);
+            return true;
+        }
+        SRC_DATA src_data{};
+        src_data.data_in = native.data();
+        src_data.input_frames = static_cast<long>(native.size() / CHANNELS);
+        src_data.src_ratio = static_cast<double>(TARGET_RATE) / static_cast<double>(result.source_rate);
+        src_data.output_frames = static_cast<long>(static_cast<double>(src_data.input_frames) * src_data.src_ratio) + 1;
+        result.samples.resize(static_cast<size_t>(src_data.output_frames) * CHANNELS);
+        src_data.data_out = result.samples.data();
+        if (int error = src_simple(&src_data, SRC_SINC_BEST_QUALITY, CHANNELS); error != 0) {
+            std::cerr << "reference resample failed: " << src_strerror(error) << std::endl;
+            return false;
+        }
+        result.samples.resize(static_cast<size_t>(src_data.output_frames_gen) * CHANNELS);
+        return true;
+    }
+
+    struct Quality {
+        double snr_db = 0;
+        int lag = 0; // 被测输出相对参考的偏移（帧），正数表示被测输出滞后
+    };
+
+    // 先在中间一段上按互相关找出最佳偏移，再在整段重叠区间上计算信噪比（两端各去掉 MAX_LAG 帧）
+    Quality measure(const std::vector<float> &reference, const std::vector<float> &test) {
+        const long ref_frames = static_cast<long>(reference.size() / CHANNELS);
+        const long test_frames = static_cast<long>(test.size() / CHANNELS);
+        const long frames = std::min(ref_frames, test_frames);
+        Quality quality;
+        if (frames <= 4 * MAX_LAG) {
+            quality.snr_db = std::numeric_limits<double>::quiet_NaN();
+            return quality;
+        }
+
+        const long window = std::min<long>(frames - 2 * MAX_LAG, 2 * TARGET_RATE);
+        const long window_start = (frames - window) / 2;
+        double best = -std::numeric_limits<double>::infinity();
+        for (int lag = -MAX_LAG; lag <= MAX_LAG; ++lag) {
+            double correlation = 0;
+            for (long i = window_start; i < window_start + window; ++i) {
+                correlation += static_cast<double>(reference[2 * i]) * test[2 * (i + lag)] +
+                               static_cast<double>(reference[2 * i + 1]) * test[2 * (i + lag) + 1];
+            }
+            if (correlation > best) {
+                best = correlation;
+                quality.lag = lag;
+            }
+        }
+
+        double signal = 0;
+        double noise = 0;
+        for (long i = MAX_LAG; i < frames - MAX_LAG; ++i) {
+            long j = i + quality.lag;
+            if (j < 0 || j >= test_frames) {
+                continue;
+            }
+            for (int c = 0; c < CHANNELS; ++c) {
+                double ref = reference[2 * i + c];
+                double diff = ref - test[2 * j + c];
+                signal += ref * ref;
+                noise += diff * diff;
+            }
+        }
+        quality.snr_db = noise > 0 ? 10.0 * std::log10(signal / noise) : std::numeric_limits<double>::infinity();
+        return quality;
+    }
+
+    void report(const char *name, const RunResult &result, double audio_seconds, const Quality &quality) {
+        std::cout << name << ": cpu " << result.cpu_seconds * 1000.0 << " ms, "
+                  << audio_seconds / result.cpu_seconds << "x realtime, SNR " << quality.snr_db << " dB (lag "
+                  << quality.lag << " frames)" << std::endl;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <file.mp3> [repeat]" << std::endl;
+        return 1;
+    }
+    const int repeat = argc > 2 ? std::max(1, std::atoi(argv[2])) : 5;
+    auto data = read_file(argv[1]);
+    if (data.empty()) {
+        std::cerr << "failed to read " << argv[1] << std::endl;
+        return 1;
+    }
+    mpg123_init();
+
+    RunResult reference;
+    if (!run_reference(data, reference)) {
+        std::cerr << "failed to decode " << argv[1] << std::endl;
+        return 1;
+    }
+    const double audio_seconds = static_cast<double>(reference.samples.size() / CHANNELS) / TARGET_RATE;
+    std::cout << argv[1] << ": source " << reference.source_rate << " Hz, " << audio_seconds << " s, best of "
+              << repeat << " runs" << std::endl;
+    if (reference.source_rate == TARGET_RATE) {
+        std::cout << "note: source is already 48 kHz, neither path resamples" << std::endl;
+    }
+
+    // 每条路径取最快的一次，质量只和解码结果有关，取最后一次即可
+    RunResult fixed;
+    RunResult src;
+    double fixed_best = std::numeric_limits<double>::infinity();
+    double src_best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < repeat; ++i) {
+        if (!run_fixed(data, fixed) || !run_src(data, src)) {
+            std::cerr << "decode failed" << std::endl;
+            return 1;
+        }
+        fixed_best = std::min(fixed_best, fixed.cpu_seconds);
+        src_best = std::min(src_best, src.cpu_seconds);
+    }
+    fixed.cpu_seconds = fixed_best;
+    src.cpu_seconds = src_best;
+
+    report("fixed (mpg123 NtoM)       ", fixed, audio_seconds, measure(reference.samples, fixed.samples));
+    report("src   (SRC_SINC_FASTEST)  ", src, audio_seconds, measure(reference.samples, src.samples));
+
+    mpg123_exit();
+    return 0;
+}
@@ -25,9 +25,9 @@ if (FFmpeg_ADDED)
             --disable-programs
             --disable-everything
             --enable-avformat  # 启用 avformat
-            --enable-parser=mp3,aac,flac
-            --enable-decoder=mp3,aac,flac,alac
-            --enable-demuxer=mp3,aac,flac,mov
+            --enable-parser=mp3,aac,flac,opus,vorbis
+            --enable-decoder=mp3,aac,flac,alac,opus,vorbis
+            --enable-demuxer=mp3,aac,flac,mov,ogg,matroska
             BUILD_COMMAND $(MAKE)
             INSTALL_COMMAND $(MAKE) install
             BUILD_IN_SOURCE 1
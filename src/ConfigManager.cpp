@@ -9,6 +9,7 @@
 DEFINE_int32(num_threads, -1, "Number of threads for the thread pool");
 DEFINE_string(log_level, "", "Logging level for the application");
 DEFINE_int32(max_connections, -1, "Maximum number of connections");
+DEFINE_bool(restore, false, "Restore all streams from the snapshot file on startup");
 
 // 获取单例实例
 ConfigManager &ConfigManager::getInstance() {
@@ -69,6 +70,9 @@ void ConfigManager::initialize(int argc, char *argv[], const std::string &config
     // 使用 gflags 配置覆盖文件中的值
     updateConfigWithFlag("num_threads", config_.num_threads);
     updateConfigWithFlag("log_level", config_.log_level);
+    if (FLAGS_restore) {
+        config_.restore = true;
+    }
 
     // 处理动态默认值
     if (config_.num_threads == 0) {
@@ -97,6 +101,14 @@ void ConfigManager::printConfig() const {
     std::cout << "num_threads: " << config_.num_threads << std::endl;
     std::cout << "log_level: " << config_.log_level << std::endl;
     std::cout << "max_connections: " << config_.max_connections << std::endl;
+    std::cout << "avio_buffer_size: " << config_.avio_buffer_size << std::endl;
+    std::cout << "mpg123_fixed_output: " << std::boolalpha << config_.mpg123_fixed_output << std::endl;
+    std::cout << "opus_passthrough: " << std::boolalpha << config_.opus_passthrough << std::endl;
+    std::cout << "status_interval_ms: " << config_.status_interval_ms << std::endl;
+    std::cout << "snapshot_path: " << config_.snapshot_path << std::endl;
+    std::cout << "snapshot_interval_s: " << config_.snapshot_interval_s << std::endl;
+    std::cout << "restore: " << std::boolalpha << config_.restore << std::endl;
+    std::cout << "restore_concurrency: " << config_.restore_concurrency << std::endl;
 }
 
 // 显式实例化模板函数
@@ -16,13 +16,29 @@ struct Config {
     std::string log_level = "INFO"; // 可选字段
     int max_connections = 100; // 可选字段
     int default_buffer_size = 24 * 1024 * 1024;
+    int avio_buffer_size = 64 * 1024; // FFmpeg 自定义 IO 每次回调读取的字节数
+    bool mpg123_fixed_output = true; // mpg123 直接输出 48kHz 立体声 S16，由 mpg123 内部重采样
+    bool opus_passthrough = true; // 源为 48kHz Opus 且码率不高于推流码率时直接转发原始包，不重新编码
+    int status_interval_ms = 200; // 状态事件聚合周期，周期内的多次变化合并为一条增量消息
+    std::string snapshot_path = "streams.snapshot"; // 流状态快照文件
+    int snapshot_interval_s = 10; // 快照周期，0 表示不写快照
+    bool restore = false; // 启动时从快照恢复所有流，也可用命令行 --restore 开启
+    int restore_concurrency = 32; // 恢复时同时启动的流数量上限
 
     // 定义 traits 以指定哪些字段是可选的
     using traits = figcone::FieldTraits<
             figcone::OptionalField<&Config::num_threads>,
             figcone::OptionalField<&Config::log_level>,
             figcone::OptionalField<&Config::max_connections>,
-            figcone::OptionalField<&Config::default_buffer_size>
+            figcone::OptionalField<&Config::default_buffer_size>,
+            figcone::OptionalField<&Config::avio_buffer_size>,
+            figcone::OptionalField<&Config::mpg123_fixed_output>,
+            figcone::OptionalField<&Config::opus_passthrough>,
+            figcone::OptionalField<&Config::status_interval_ms>,
+            figcone::OptionalField<&Config::snapshot_path>,
+            figcone::OptionalField<&Config::snapshot_interval_s>,
+            figcone::OptionalField<&Config::restore>,
+            figcone::OptionalField<&Config::restore_concurrency>
     >;
 };
 
@@ -4,6 +4,8 @@
 #include <mpg123.h>
 #include <utility>
 #include <fstream>
+#include <algorithm>
+#include <cmath>
 #include "../../api/handlers/Handlers.h"
 #include "../../RTPManager/RTPManager.h"
 #include "AudioAlignedAlloc.h"
@@ -38,6 +40,8 @@ AudioSender::AudioSender(std::string stream_id, std::shared_ptr<RTPInstance> rtp
         return;
     }*/
 
+    governor_entry_ = OpusComplexityGovernor::getInstance().registerStream(stream_id_);
+
     int error;
     opus_encoder_ = opus_encoder_create(48000, 2, OPUS_APPLICATION_AUDIO, &error);
     if (error != OPUS_OK) {
@@ -47,7 +51,7 @@ AudioSender::AudioSender(std::string stream_id, std::shared_ptr<RTPInstance> rtp
 
     opus_encoder_ctl(opus_encoder_, OPUS_SET_VBR(1)); // 启用变码率。
     opus_encoder_ctl(opus_encoder_, OPUS_SET_VBR_CONSTRAINT(1)); // 限制编码率波动范围。
-    opus_encoder_ctl(opus_encoder_, OPUS_SET_COMPLEXITY(10)); // 复杂度 10
+    opus_encoder_ctl(opus_encoder_, OPUS_SET_COMPLEXITY(OpusComplexityGovernor::MAX_COMPLEXITY)); // 复杂度 10，之后由调节器接管
     opus_encoder_ctl(opus_encoder_, OPUS_SET_SIGNAL(OPUS_SIGNAL_MUSIC)); // Signal being encoded is music
     opus_encoder_ctl(opus_encoder_, OPUS_SET_BANDWIDTH(OPUS_AUTO)); // 让他自己根据参数设定
     opus_encoder_ctl(opus_encoder_, OPUS_SET_INBAND_FEC(0)); // 禁用FEC
@@ -57,19 +61,37 @@ AudioSender::AudioSender(std::string stream_id, std::shared_ptr<RTPInstance> rtp
     opus_encoder_ctl(opus_encoder_, OPUS_SET_PACKET_LOSS_PERC(0));*/
     // opus_encoder_ctl(opus_encoder_, OPUS_SET_BITRATE(128 * 1000));
 
-    mpg123_decoder.setBuffer(&data_wrapper);
-    ffmpeg_decoder.setBuffer(&data_wrapper);
-    using_decoder = &mpg123_decoder;
+    opus_repacketizer_ = opus_repacketizer_create();
+    if (!opus_repacketizer_) {
+        LOG(ERROR) << "Failed to create Opus repacketizer";
+        return;
+    }
+    passthrough_repacketizer_ = opus_repacketizer_create();
+    if (!passthrough_repacketizer_) {
+        LOG(ERROR) << "Failed to create Opus repacketizer";
+        return;
+    }
 
     initialized_ = true;
     LOG(INFO) << "Stream setup successfully with ID: " << stream_id_;
 }
 
 AudioSender::~AudioSender() {
+    if (governor_entry_) {
+        OpusComplexityGovernor::getInstance().unregisterStream(governor_entry_);
+    }
     if (opus_encoder_) {
         opus_encoder_destroy(opus_encoder_);
         opus_encoder_ = nullptr;
     }
+    if (opus_repacketizer_) {
+        opus_repacketizer_destroy(opus_repacketizer_);
+        opus_repacketizer_ = nullptr;
+    }
+    if (passthrough_repacketizer_) {
+        opus_repacketizer_destroy(passthrough_repacketizer_);
+        passthrough_repacketizer_ = nullptr;
+    }
 }
 
 bool AudioSender::is_initialized() const {
@@ -99,5 +121,68 @@ void AudioSender::finalize_opus_file() {
 
 int AudioSender::setOpusBitRate(const int &kbps) {
     // 设置 Opus 比特率
+    stats_.bitrate.store(kbps, std::memory_order_relaxed);
     return opus_encoder_ctl(opus_encoder_, OPUS_SET_BITRATE(kbps));
 }
+
+float AudioSender::pcmFill() const {
+    return static_cast<float>(pcm_ring_.size()) / static_cast<float>(pcm_ring_.capacity());
+}
+
+float AudioSender::packetFill() const {
+    return static_cast<float>(rb.size()) / static_cast<float>(rb.capacity());
+}
+
+void AudioSender::restoreState(float volume, PlayState state, int resume_seconds,
+                               std::optional<uint32_t> rtp_timestamp) {
+    audio_props.volume = std::round(volume * 100.0f) / 100.0f;
+    audio_props.play_state = state;
+    resume_seconds_.store(std::max(0, resume_seconds), std::memory_order_relaxed);
+    initial_timestamp_ = rtp_timestamp;
+    publish_stats();
+}
+
+void AudioSender::publish_stats() {
+    long rate = audio_props.rate > 0 ? audio_props.rate : TARGET_SAMPLE_RATE;
+    stats_.time_played_ms.store(static_cast<uint32_t>(audio_props.current_samples * 1000LL / rate),
+                                std::memory_order_relaxed);
+    stats_.time_total_ms.store(static_cast<uint32_t>(audio_props.total_samples * 1000LL / rate),
+                               std::memory_order_relaxed);
+    stats_.play_state.store(static_cast<uint8_t>(audio_props.play_state), std::memory_order_relaxed);
+    stats_.volume.store(audio_props.volume, std::memory_order_relaxed);
+}
+
+void AudioSender::setComplexityPolicy(int priority, int floor) {
+    if (governor_entry_) {
+        OpusComplexityGovernor::setPolicy(*governor_entry_, priority, floor);
+    }
+}
+
+bool AudioSender::setFrameDuration(int frame_duration_ms) {
+    switch (frame_duration_ms) {
+        case 10:
+        case 20:
+        case 40:
+        case 60:
+            opus_delay_ = frame_duration_ms;
+            opus_framesize_ = TARGET_SAMPLE_RATE / 1000 * frame_duration_ms;
+            // 帧变长后原有的打包帧数可能超过 120ms 上限
+            frames_per_packet_ = std::max(1, std::min(frames_per_packet_, MAX_PACKET_DURATION / opus_delay_));
+            return true;
+        default:
+            return false;
+    }
+}
+
+int AudioSender::getFrameDuration() const {
+    return opus_delay_;
+}
+
+bool AudioSender::setFramesPerPacket(int frames_per_packet) {
+    if (frames_per_packet < 1 || frames_per_packet > MAX_FRAMES_PER_PACKET ||
+        frames_per_packet * opus_delay_ > MAX_PACKET_DURATION) {
+        return false;
+    }
+    frames_per_packet_ = frames_per_packet;
+    return true;
+}
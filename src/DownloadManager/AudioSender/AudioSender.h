@@ -8,6 +8,7 @@
 #include "decoder/AudioDecoder.h"
 #include "decoder/AudioDecoder_Mpg123.h"
 #include "decoder/AudioDecoder_FFmpeg.h"
+#include "decoder/DecoderPool.h"
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -22,10 +23,17 @@ extern "C" {
 #include <uvgrtp/lib.hh>
 #include <opus.h>
 #include <vector>
+#include <array>
+#include <mutex>
+#include <optional>
 #include <random>
 #include "../../RTPManager/RTPInstance.h" // 更新相对路径
 #include "../utils/ExtendedTaskItem.h" // 包含 ExtendedTaskItem
+#include "../utils/SpscRing.h"
 #include "AudioAlignedAlloc.h"
+#include "OpusComplexityGovernor.h"
+#include "StreamStats.h"
+#include "StreamMetrics.h"
 
 // Forward declarations
 class ExtendedTaskItem;
@@ -53,20 +61,22 @@ struct AudioProps {
     float volume = 1.0f;
 
     bool do_empty_ring_buffer = false;
+    // 当前曲目可以直通原始 Opus 包（音量不为 1.0 时仍会临时转码）
+    bool opus_passthrough = false;
 
     void reset() {
         info_found = false;
+        opus_passthrough = false;
         detectedFormat = nullptr;
         current_samples = 0;
         total_samples = 0;
     }
 };
 
-struct OpusTempBuffer {
-    std::vector<int16_t> temp_buffer;
-    size_t temp_samples = 0;
-
-    explicit OpusTempBuffer(size_t temp_buffer_length) : temp_buffer(temp_buffer_length, 0) {}
+// 放入发送环形缓冲区的 RTP 负载：单帧 Opus 包，或 RFC 6716 code 3 打包后的多帧包
+struct OpusPacket {
+    std::vector<uint8_t> data;
+    int frames = 1; // 包内帧数，发送端据此推进 RTP 时间戳与节奏
 };
 
 class AudioSender {
@@ -82,8 +92,12 @@ public:
 
     coro::task<void> start_producer(const std::shared_ptr<ExtendedTaskItem> *ptr, const bool &isStopped);
 
+    // 解码阶段：解码、重采样、音量处理后写入 PCM 环形缓冲区
     coro::task<void> start_consumer(const bool &isStopped);
 
+    // 编码阶段：从 PCM 环形缓冲区按帧取样本编码，写入发送环形缓冲区
+    coro::task<void> start_encoder(const bool &isStopped);
+
     coro::task<void> start_sender(const bool &isStopped);
 
     bool doSkip();
@@ -102,29 +116,114 @@ public:
     coro::event EventStateUpdate;
 
     std::shared_ptr<ExtendedTaskItem> task;
-    DataVariant data_wrapper = BufferWarp();
+    std::unique_ptr<ByteSource> source_; // 当前任务的数据源，解码器只借用指针
+    ChainSource *chain_source_ = nullptr; // 流式下载时指向 source_，用于释放已读过的块
 
-    AudioDecoder *using_decoder = nullptr;
-    Mpg123Decoder mpg123_decoder;
-    FfmpegDecoder ffmpeg_decoder;
+    AudioDecoder *using_decoder = nullptr; // 指向 decoder_lease_，没有曲目在播放时为空
+    DecoderPool::Lease decoder_lease_;
+    // 保护 using_decoder 的租借与归还：解码阶段读取、seekSecond 与归还互斥，归还后解码器不会再被本流使用
+    std::mutex decoder_mutex_;
+    // 正在取回的 MP4 尾部：doSkip 与 clean_up 关闭它来唤醒等待尾部的控制阶段，持有 tail_mutex_ 期间等待者不会离开
+    std::shared_ptr<RangedHttpSource> pending_tail_;
+    std::mutex tail_mutex_;
 
     AudioProps audio_props;
 
     int setOpusBitRate(const int &kbps);
 
+    // 设置每帧时长（毫秒），仅支持 10/20/40/60，必须在开始发送前调用
+    bool setFrameDuration(int frame_duration_ms);
+
+    [[nodiscard]] int getFrameDuration() const;
+
+    // 设置每个 RTP 包打包的帧数（1~3），大于 1 时使用 opus_repacketizer 合并多帧以降低每秒包数
+    // 包总时长不超过 120ms，必须在 setFrameDuration 之后、开始发送前调用
+    bool setFramesPerPacket(int frames_per_packet);
+
+    // 设置复杂度调节策略：priority 越大越晚被降级，floor 为允许的最低复杂度
+    void setComplexityPolicy(int priority, int floor);
+
+    [[nodiscard]] const StreamStats &stats() const { return stats_; }
+
+    // 性能指标，下载侧（curl 线程）也会写入
+    [[nodiscard]] StreamMetrics &metrics() { return metrics_; }
+
+    [[nodiscard]] const StreamMetrics &metrics() const { return metrics_; }
+
+    // 从快照恢复：必须在开始发送前调用。音量与播放状态立即生效，第一首曲目开始解码前跳到 resume_seconds
+    void restoreState(float volume, PlayState state, int resume_seconds, std::optional<uint32_t> rtp_timestamp);
+
+    // 两个环形缓冲区的填充率（0~1），无锁读取
+    [[nodiscard]] float pcmFill() const;
+
+    [[nodiscard]] float packetFill() const;
+
 private:
     std::shared_ptr<RTPInstance> rtp_instance_;
 
+    StreamStats stats_;
+    StreamMetrics metrics_;
+
+    std::atomic<int> resume_seconds_{0};            // 恢复后第一首曲目的起始位置，用过即清零
+    std::optional<uint32_t> initial_timestamp_;     // 恢复后的起始 RTP 时间戳
+
+    // 把 audio_props 中的播放位置、总时长、状态与音量同步到 stats_，只由修改 audio_props 的一方调用
+    void publish_stats();
+
+    // 关闭正在取回的 MP4 尾部请求（如果有）
+    void close_pending_tail();
+
     bool initialized_ = false;
     OpusEncoder *opus_encoder_ = nullptr;
+    OpusRepacketizer *opus_repacketizer_ = nullptr;
+    std::shared_ptr<OpusComplexityGovernor::Entry> governor_entry_;
 
     std::shared_ptr<coro::thread_pool> tp_;
     std::shared_ptr<coro::io_scheduler> scheduler_;
-    coro::ring_buffer<std::vector<uint8_t>, 25> rb;
+
+    // 流水线：解码阶段 → pcm_ring_ → 编码阶段 → rb → 发送阶段，两段都是有界无锁 SPSC
+    static constexpr int ENCODER_CHANNELS = 2;
+    static constexpr size_t PCM_RING_SAMPLES = 32768; // 48kHz 立体声约 340ms
+    static constexpr size_t PACKET_RING_SIZE = 32;
+    AsyncSpscRing<int16_t> pcm_ring_{PCM_RING_SAMPLES}; // 48kHz 交错立体声 PCM
+    AsyncSpscRing<OpusPacket> rb{PACKET_RING_SIZE};
+    std::atomic<bool> flush_pcm_ring_{false};   // seek 后由编码阶段丢弃旧 PCM 与待合并帧
+    std::atomic<bool> flush_tail_frames_{false}; // 曲目读完后由编码阶段发出待合并的尾帧
+
+    // Opus 直通：解码阶段把源包按发送帧长重新打包后经 passthrough_ring_ 交给编码阶段，由它原样放入 rb，
+    // rb 仍然只有编码阶段一个生产者。两条路径切换前先等另一条排空，保证包序
+    static constexpr size_t PASSTHROUGH_RING_SIZE = 16;
+    AsyncSpscRing<OpusPacket> passthrough_ring_{PASSTHROUGH_RING_SIZE};
+    OpusRepacketizer *passthrough_repacketizer_ = nullptr;
+    std::vector<std::vector<uint8_t>> passthrough_pending_; // 等待合并的源包，repacketizer 只保存指针
+    int passthrough_pending_samples_ = 0;
+    int passthrough_pending_bytes_ = 0;
+    bool passthrough_active_ = false;              // 解码阶段当前是否走直通，只由解码阶段访问
+    std::atomic<bool> flush_passthrough_{false};   // seek 后由解码阶段丢弃待合并的源包
+    std::vector<uint8_t> passthrough_packet_;
 
     static constexpr int TARGET_SAMPLE_RATE = 48000;
-    static constexpr int OPUS_DELAY = 40;
-    static constexpr int OPUS_FRAMESIZE = static_cast<int>(TARGET_SAMPLE_RATE * OPUS_DELAY * 0.001);
+    static constexpr int DEFAULT_OPUS_DELAY = 40;
+    static constexpr int MAX_OPUS_DELAY = 60;
+    static constexpr int MAX_OPUS_FRAMESIZE = TARGET_SAMPLE_RATE / 1000 * MAX_OPUS_DELAY;
+
+    // 每条流自己的帧时长与对应的每声道样本数（同时也是 RTP 时间戳增量）
+    int opus_delay_ = DEFAULT_OPUS_DELAY;
+    int opus_framesize_ = TARGET_SAMPLE_RATE / 1000 * DEFAULT_OPUS_DELAY;
+
+    // 多帧打包：RFC 6716 限制单包最长 120ms，负载上限为 MTU 减去 RTP 固定头
+    static constexpr int MAX_FRAMES_PER_PACKET = 3;
+    static constexpr int MAX_PACKET_DURATION = 120;
+    static constexpr int MAX_RTP_PAYLOAD = RTP_MTU_SIZE - RTP_HEADER_SIZE;
+    int frames_per_packet_ = 1;
+    // 等待合并的已编码帧，repacketizer 只保存指针，所以帧数据必须在 out 之前保持有效
+    std::array<std::vector<uint8_t>, MAX_FRAMES_PER_PACKET> pending_frames_;
+    int pending_count_ = 0;
+    int pending_bytes_ = 0;
+
+    // 按帧时长编译期特化的发送循环，start_sender 根据 opus_delay_ 选择实例
+    template<int FrameMs>
+    coro::task<void> run_sender(const bool &isStopped);
 
 /*    OggOpusEnc *enc{};
     OggOpusComments *comments{};*/
@@ -134,8 +233,51 @@ private:
 
     void finalize_opus_file();*/
 
-    coro::task<int> encode_opus_frame(OpusEncoder *encoder, int16_t *pcm_data, size_t total_samples,
-                                      OpusTempBuffer &temp_buffer, int max_data_bytes);
+    static constexpr int MAX_OPUS_PACKET_SIZE = 4000; // 单帧 Opus 包上限（RFC 6716: 1275 * 3 + 7）
+    static constexpr size_t STREAM_KEEP_BEHIND = 256 * 1024; // 流式数据源保留在读取位置之前的字节数，供解码器小幅回退
+    static constexpr size_t PROGRESSIVE_WAKE_BYTES = 64 * 1024; // 整段缓冲区边下边解时，每收到这么多数据唤醒一次解码阶段
+
+    // 格式探测窗口从 MIN_PROBE_SIZE 倍增到 MAX_PROBE_SIZE，与 FFmpeg 自身的探测策略一致
+    static constexpr size_t MIN_PROBE_SIZE = 2048;
+    static constexpr size_t MAX_PROBE_SIZE = 1 << 20;
+    std::vector<uint8_t> probe_scratch_; // 探测数据不连续时使用的补零缓冲区，跨曲目复用
+
+    // 为当前任务创建数据源
+    void attach_source(ExtendedTaskItem *current_task);
+
+    // 逐步增大探测窗口识别容器格式，无法识别时返回 nullptr
+    coro::task<const AVInputFormat *> probe_format(ExtendedTaskItem *current_task);
+
+    // MP4/M4A：moov 在前时等它下载完即可边下边解，moov 在尾部时先用 Range 请求取回尾部；返回 false 表示只能等整个文件下载完
+    coro::task<bool> prepare_mp4_source(ExtendedTaskItem *current_task);
+
+    // 从 DecoderPool 租用指定类型的解码器并绑定当前数据源
+    void lease_decoder(DecoderPool::Kind kind);
+
+    // 把 curl 线程发布的数据块并入任务的 IOBufQueue
+    coro::task<void> sync_download_data(ExtendedTaskItem *current_task);
+
+    int encode_single_frame(OpusEncoder *encoder, const int16_t *pcm, unsigned char *out, int max_bytes);
+
+    // 将编完的一帧交给发送环形缓冲区，开启多帧打包时先攒够帧数再合并
+    coro::task<void> emit_encoded_frame(const uint8_t *data, int len);
+
+    // 把已攒的帧合并为一个包放入环形缓冲区（曲目结束时也需要调用，避免尾部滞留）
+    coro::task<void> flush_pending_frames();
+
+    // 判断当前曲目能否直通：配置开启、FFmpeg 解出的是 Opus，且码率不高于推流码率
+    bool can_passthrough_opus();
+
+    // 切换解码阶段的输出路径，先等待另一条路径排空；返回 false 表示环形缓冲区已关闭
+    coro::task<bool> switch_passthrough(bool enable);
+
+    // 按发送帧长攒源包，够一个发送包后放入 passthrough_ring_；源包帧长对不齐时返回 false，本曲改为转码
+    coro::task<bool> queue_passthrough_packet(const std::vector<uint8_t> &packet);
+
+    coro::task<void> flush_passthrough_pending();
+
+    // 编码阶段：先发出已攒的编码帧与不足一帧的 PCM 尾巴，再转发直通包
+    coro::task<void> forward_passthrough_packets(std::vector<int16_t> &frame, std::vector<uint8_t> &encoded_frame);
 
     static constexpr int MAX_DECODE_SIZE = 73728;
     static constexpr int MAX_PCM_SIZE = 131072;
@@ -144,6 +286,9 @@ private:
     AlignedMem::AlignedUniquePtr<float> float_buffer_;
     AlignedMem::AlignedUniquePtr<int16_t> resampled_buffer_;
 
+    // 把处理好的 PCM 写入 pcm_ring_，单声道会展开为立体声；返回 false 表示环形缓冲区已关闭
+    coro::task<bool> write_pcm(const int16_t *pcm_data, int samples_per_channel, int channelCount);
+
     bool resample_audio(int &totalSamples, int channelCount, long rate, float volume);
 
     bool
@@ -1,46 +1,39 @@
 #include "AudioSender.h"
+#include "../utils/Mp4Layout.h"
 
 constexpr const char *mp3_format = "mp3";
 constexpr const char *mov_format = "mov,mp4,m4a,3gp,3g2,mj2";
 
-const AVInputFormat *detect_format(std::vector<char> &audio_data) {
+// 从数据源开头探测容器格式，调用前后读取位置都在 0。
+// 借出的连续数据足够 probe_size + AVPROBE_PADDING_SIZE 时直接在数据源上探测，不拷贝：
+// 末尾的“填充”是真实数据而不是 0，启用的二进制格式探测函数只需要这部分内存可读；不连续时才拷到可复用的补零缓冲区。
+static const AVInputFormat *detect_format(ByteSource &source, size_t probe_size, int *score,
+                                          std::vector<uint8_t> &scratch) {
     AVProbeData probeData = {};
-
-    // 如果数据长度小于 4096 则使用实际大小，否则只探测前 4096 字节
-    probeData.buf_size = audio_data.size() < 4096 ? audio_data.size() : 4096;
-
     // 设置虚拟文件名为 "stream"（可为空，但加上增强可读性）
     probeData.filename = "stream";
 
-    // FFmpeg 要求缓冲区必须有 AVPROBE_PADDING_SIZE 的零填充，以防止溢出读取
-    // 使用 av_mallocz 分配内存，自动分配 buf_size + AVPROBE_PADDING_SIZE 大小并填充 0
-    probeData.buf = static_cast<unsigned char *>(av_mallocz(probeData.buf_size + AVPROBE_PADDING_SIZE));
-
-    // 将音频数据拷贝到新分配的缓冲区中，注意仅拷贝实际大小的数据部分
-    memcpy(probeData.buf, audio_data.data(), probeData.buf_size);
-
-    // 调用 FFmpeg 进行格式探测，返回可能的格式
-    const AVInputFormat *fmt = av_probe_input_format(&probeData, 1);
-
-    // 检查返回的格式是否为空
-    if (!fmt) {
-        // 如果无法识别格式，输出错误日志
-        LOG(ERROR) << "无法识别格式";
+    auto span = source.peek(probe_size + AVPROBE_PADDING_SIZE);
+    if (span.size() == probe_size + AVPROBE_PADDING_SIZE) {
+        probeData.buf = const_cast<unsigned char *>(span.data());
+        probeData.buf_size = static_cast<int>(probe_size);
+    } else {
+        size_t length = std::min(probe_size, source.available());
+        scratch.assign(length + AVPROBE_PADDING_SIZE, 0);
+        length = source.read_into(scratch.data(), length);
+        source.seek(0);
+        probeData.buf = scratch.data();
+        probeData.buf_size = static_cast<int>(length);
     }
 
-    // 释放 av_mallocz 分配的内存
-    av_free(probeData.buf);
-
-    return fmt;
+    *score = 0;
+    return av_probe_input_format3(&probeData, 1, score);
 }
 
-#include "../../api/EventPublisher.h"
+#include "../../api/StatusAggregator.h"
 
 // 第一个参数是指针的指针
 coro::task<void> AudioSender::start_producer(const std::shared_ptr<ExtendedTaskItem> *ptr, const bool &isStopped) {
-    std::vector<char> audio_data;
-    audio_data.reserve(4096);
-
     while (true) {
         if (isStopped) {
             VLOG(1) << "控制任务已退出。";
@@ -64,23 +57,10 @@ coro::task<void> AudioSender::start_producer(const std::shared_ptr<ExtendedTaskI
         task = download_task;
 
         auto current_task = task.get();
-        auto data = &current_task->data;
-        if (auto *fixed_buffer = std::get_if<FixedCapacityBuffer>(data)) {
-            data_wrapper = BufferWarp(fixed_buffer);
-        } else if (auto *iobuf = std::get_if<folly::IOBufQueue>(data)) {
-            data_wrapper = IOBufWarp(iobuf);
-        }
-
-        auto data_interface = getBasePtr(data_wrapper);
+        attach_source(current_task);
 
         if (audio_props.detectedFormat == nullptr) {
-            while (current_task->state == AudioCurrentState::Downloading && data_interface->size() < 4096) {
-                // 不再允许 Curl 通知数据入列，在别处触发事件会导致逻辑跑到那个线程上，使用 yield 排队。
-                co_await tp_->yield();
-            }
-
-            data_interface->readFront(audio_data, 4096);
-            audio_props.detectedFormat = detect_format(audio_data);
+            audio_props.detectedFormat = co_await probe_format(current_task);
 
             if (audio_props.detectedFormat == nullptr) {
                 LOG(ERROR) << "未知格式！任务" << current_task->item.name << "(" << current_task->item.url << ")";
@@ -89,76 +69,84 @@ coro::task<void> AudioSender::start_producer(const std::shared_ptr<ExtendedTaskI
             }
 
             if (strcmp(audio_props.detectedFormat->name, mp3_format) == 0) {
-                using_decoder = &mpg123_decoder;
+                lease_decoder(DecoderPool::Kind::Mpg123);
+                static_cast<Mpg123Decoder *>(using_decoder)->setFrameIndex(&current_task->mp3_index);
                 LOG(INFO) << "格式" << audio_props.detectedFormat->name;
-            } else if (strcmp(audio_props.detectedFormat->name, mov_format) == 0) {
-                // 必须等下载完才能正确解析该类型格式。
-                co_await current_task->EventDownloadFinished;
-                using_decoder = &ffmpeg_decoder;
             } else {
+                current_task->mp3_index.disable();
+                if (strcmp(audio_props.detectedFormat->name, mov_format) == 0 &&
+                    !co_await prepare_mp4_source(current_task)) {
+                    // 布局无法判断或取不回尾部，只能等下载完再解析。
+                    co_await current_task->EventDownloadFinished;
+                    co_await sync_download_data(current_task);
+                }
                 LOG(INFO) << "格式" << audio_props.detectedFormat->name;
-                using_decoder = &ffmpeg_decoder;
+                lease_decoder(DecoderPool::Kind::FFmpeg);
+                static_cast<FfmpegDecoder *>(using_decoder)->setInputFormat(audio_props.detectedFormat);
             }
             using_decoder->setup();
         }
 
-        audio_data.clear();
+        // 解码器报告出格式才开始解码；数据不足时登记字节阈值等下载侧唤醒，每次多等一倍
+        size_t wait_step = MIN_PROBE_SIZE;
+        while (!audio_props.info_found) {
+            // 先取下载状态再并入数据，判定为已结束时手里的数据一定是全部数据
+            bool receiving = current_task->is_receiving();
+            co_await sync_download_data(current_task);
+            auto info = using_decoder->getAudioFormat();
+            if (info.channels == 0) {
+                if (!receiving) {
+                    LOG(ERROR) << "找不到音频信息" << current_task->item.name;
+                    break;
+                }
+                co_await current_task->wait_for_bytes(*tp_, current_task->received_bytes.load() + wait_step);
+                wait_step = std::min(wait_step * 2, MAX_PROBE_SIZE);
+                continue;
+            }
+            audio_props.channels = info.channels;
+            audio_props.rate = info.sample_rate;
+            audio_props.bytes_per_sample = info.bytes_per_sample;
+            audio_props.bits_per_samples = info.bits_per_samples;
+            if (info.encoding != -1) {
+                audio_props.encoding = info.encoding;
+            }
 
-        // 数据量不足时不要开始解码！基础保险。
-        while (current_task->state == AudioCurrentState::Downloading && data_interface->size() < 16384 * 30) {
-            co_await tp_->yield();
+            audio_props.info_found = true;
         }
 
-        {
-            // co_await current_task->mutex_data.lock();
-            int err_count = 0;
-            int max_err_count = 3;
-            while (!audio_props.info_found) {
-                if (err_count > max_err_count - 1) {
-                    co_await current_task->EventDownloadFinished;
-                }
-                auto info = using_decoder->getAudioFormat();
-                if (info.channels == 0) {
-                    LOG(ERROR) << "找不到音频信息" << current_task->item.name;
-                    err_count++;
-                    if (err_count > max_err_count) {
-                        break;
-                    } else {
-                        continue;
-                    }
-                }
-                audio_props.channels = info.channels;
-                audio_props.rate = info.sample_rate;
-                audio_props.bytes_per_sample = info.bytes_per_sample;
-                audio_props.bits_per_samples = info.bits_per_samples;
-                if (info.encoding != -1) {
-                    audio_props.encoding = info.encoding;
-                }
+        audio_props.opus_passthrough = audio_props.info_found && can_passthrough_opus();
+        if (audio_props.opus_passthrough) {
+            LOG(INFO) << "Opus 直通：" << current_task->item.name;
+        }
 
-                audio_props.info_found = true;
-            }
+        // MP3 有帧索引时下载完成前就能给出总时长，之后下载完成再更新为精确值
+        audio_props.total_samples = using_decoder->getTotalSamples();
+        if (int resume = resume_seconds_.exchange(0, std::memory_order_relaxed); resume > 0 && audio_props.info_found) {
+            // 从快照恢复的第一首曲目：回到停机前的位置
+            using_decoder->seek(resume);
+            audio_props.current_samples = using_decoder->getCurrentSamples();
         }
+        publish_stats();
 
         // 此处标志正式开始解码
         EventFeedDecoder.set();
-        EventPublisher::getInstance().handle_event_publish(stream_id_, false);
+        StatusAggregator::getInstance().mark_dirty(stream_id_);
 
         if (current_task->state < AudioCurrentState::DownloadAndWriteFinished) {
-            while (current_task->item.use_stream) {
-                co_await scheduler_->yield_for(std::chrono::milliseconds(2000));
-                if (current_task->EventDownloadFinished.is_set()) {
-                    break;
-                }
-                EventFeedDecoder.set();
-            }
+            // 流式下载时解码阶段自己等待 curl 发布的数据块，这里只需等下载结束
             co_await current_task->EventDownloadFinished;
+            // 先标记数据源完成再唤醒，解码阶段重试时才能正确读到末尾
+            co_await sync_download_data(current_task);
+            source_->mark_complete();
             EventFeedDecoder.set();
         }
 
-        // 此处表明下载写入完成，is_eof 控制着 io，只有 is_eof 为 true 时解码侧才有可能 EventReadFinshed.set()
-        data_interface->is_eof = true;
+        // 此处表明下载写入完成，数据源标记完成后解码侧才有可能 EventReadFinshed.set()
+        co_await sync_download_data(current_task);
+        source_->mark_complete();
         audio_props.total_samples = using_decoder->getTotalSamples();
-        EventPublisher::getInstance().handle_event_publish(stream_id_, false);
+        publish_stats();
+        StatusAggregator::getInstance().mark_dirty(stream_id_);
 
         VLOG(1) << "等待" << current_task->item.name;
         co_await EventReadFinshed;
@@ -169,8 +157,132 @@ coro::task<void> AudioSender::start_producer(const std::shared_ptr<ExtendedTaskI
         current_task->EventReadFinished.set();
         current_task->state = AudioCurrentState::DrainFinished;
         audio_props.reset();
-        using_decoder->reset();
+        publish_stats();
+        // 归还解码器，归还时由池负责 reset；解码阶段可能仍在 read 或 seekSecond 中，等它离开解码器再归还
+        {
+            std::lock_guard<std::mutex> decoder_lock(decoder_mutex_);
+            using_decoder = nullptr;
+            decoder_lease_.reset();
+        }
+    }
+}
+
+// 从 MIN_PROBE_SIZE 开始倍增探测窗口，每次登记字节阈值等下载侧唤醒；得分足够高、窗口到上限或下载结束时定下格式
+coro::task<const AVInputFormat *> AudioSender::probe_format(ExtendedTaskItem *current_task) {
+    for (size_t probe_size = MIN_PROBE_SIZE;; probe_size = std::min(probe_size * 2, MAX_PROBE_SIZE)) {
+        co_await current_task->wait_for_bytes(*tp_, probe_size + AVPROBE_PADDING_SIZE);
+        bool final = !current_task->is_receiving() || probe_size >= MAX_PROBE_SIZE;
+        co_await sync_download_data(current_task);
+
+        int score = 0;
+        const AVInputFormat *format = detect_format(*source_, probe_size, &score, probe_scratch_);
+        if (final || (format != nullptr && score > AVPROBE_SCORE_RETRY)) {
+            VLOG(1) << "探测 " << probe_size << " 字节，格式 " << (format ? format->name : "未知") << "，得分 " << score;
+            co_return format;
+        }
+    }
+}
+
+// 按下载方式创建数据源：整段缓冲区用 MemorySource，流式下载的 IOBuf 链用 ChainSource，解码器在识别格式后再租用
+void AudioSender::attach_source(ExtendedTaskItem *current_task) {
+    chain_source_ = nullptr;
+    if (auto *iobuf = std::get_if<folly::IOBufQueue>(&current_task->data)) {
+        auto chain = std::make_unique<ChainSource>(iobuf);
+        chain_source_ = chain.get();
+        source_ = std::move(chain);
+    } else {
+        source_ = std::make_unique<MemorySource>(&std::get<FixedCapacityBuffer>(current_task->data));
+    }
+}
+
+coro::task<bool> AudioSender::prepare_mp4_source(ExtendedTaskItem *current_task) {
+    Mp4Layout layout;
+    size_t wait_step = MIN_PROBE_SIZE;
+    while (true) {
+        co_await sync_download_data(current_task);
+        layout = probe_mp4_layout(*source_);
+        if (layout.kind != Mp4Layout::Kind::Unknown || !current_task->is_receiving()) {
+            break;
+        }
+        // 顶层 box 头还没到，等下载侧越过阈值再看
+        co_await current_task->wait_for_bytes(*tp_, current_task->received_bytes.load() + wait_step);
+        wait_step = std::min(wait_step * 2, MAX_PROBE_SIZE);
+    }
+
+    if (layout.kind == Mp4Layout::Kind::MoovFirst) {
+        // faststart：moov 完整下载后即可打开解码器，mdat 边下边解
+        if (layout.moov_end != UINT64_MAX) {
+            co_await current_task->wait_for_bytes(*tp_, static_cast<size_t>(layout.moov_end));
+        } else {
+            co_await current_task->EventDownloadFinished;
+        }
+        co_await sync_download_data(current_task);
+        VLOG(1) << "[MP4] moov 位于开头，结束于 " << layout.moov_end << "，边下载边解码";
+        co_return true;
+    }
+    if (layout.kind != Mp4Layout::Kind::MoovAtTail || !current_task->is_receiving()) {
+        co_return false;
+    }
+
+    size_t total = current_task->expected_size.load();
+    if (total <= layout.tail_offset || current_task->effective_url.empty()) {
+        VLOG(1) << "[MP4] moov 位于尾部但文件大小未知，等待下载完成";
+        co_return false;
+    }
+
+    // moov 在尾部：用一个 Range 请求取回 mdat 之后的全部数据，拼在顺序下载的数据后面
+    size_t tail_length = total - layout.tail_offset;
+    auto ranged = RangedHttpSource::create(current_task->effective_url, total, tail_length);
+    if (current_task->request_options) {
+        ranged->set_request_options(current_task->request_options);
     }
+    coro::event tail_ready;
+    ranged->set_data_callback([&tail_ready] { tail_ready.set(); });
+    {
+        std::lock_guard<std::mutex> tail_lock(tail_mutex_);
+        pending_tail_ = ranged;
+    }
+    if (!current_task->is_receiving()) {
+        // 登记之前已经被跳过
+        close_pending_tail();
+    }
+    ranged->prefetch(layout.tail_offset, tail_length);
+    co_await tail_ready;
+    // 回调在 curl 线程（或调用 doSkip 的线程）上恢复协程，切回线程池
+    co_await tp_->schedule();
+    {
+        // 之后 tail_ready 即将失效，不允许再被关闭回调触碰
+        std::lock_guard<std::mutex> tail_lock(tail_mutex_);
+        pending_tail_ = nullptr;
+    }
+
+    std::vector<uint8_t> tail(tail_length);
+    if (ranged->has_failed() || !ranged->seek(layout.tail_offset) ||
+        ranged->read_into(tail.data(), tail.size()) != tail.size()) {
+        LOG(WARNING) << "[MP4] 取回尾部 moov 失败，等待下载完成：" << current_task->item.name;
+        co_return false;
+    }
+
+    VLOG(1) << "[MP4] 已取回尾部 " << tail_length << " 字节（offset " << layout.tail_offset << "），边下载边解码";
+    source_ = std::make_unique<TailPatchedSource>(std::move(source_), layout.tail_offset, std::move(tail));
+    co_return true;
+}
+
+void AudioSender::lease_decoder(DecoderPool::Kind kind) {
+    auto lease = DecoderPool::getInstance().acquire(kind);
+    lease->setSource(source_.get());
+    std::lock_guard<std::mutex> decoder_lock(decoder_mutex_);
+    decoder_lease_ = std::move(lease);
+    using_decoder = decoder_lease_.get();
+}
+
+// 把 curl 线程发布的数据块并入任务的 IOBufQueue，与解码阶段通过 mutex_data 互斥
+coro::task<void> AudioSender::sync_download_data(ExtendedTaskItem *current_task) {
+    if (!current_task->isIOBufQueue()) {
+        co_return;
+    }
+    auto lock = co_await current_task->mutex_data.lock();
+    current_task->drainChunks();
 }
 
 // 该函数负责单个 Control 周期顺利通过，外部无需担心 current_task 的设置问题。
@@ -183,18 +295,32 @@ bool AudioSender::doSkip() {
     auto current_task = task.get();
     LOG(INFO) << "跳过被调用于任务" << current_task->item.name;
     current_task->state = AudioCurrentState::DownloadAndWriteFinished;
+    // 唤醒可能在等待下载数据的解码阶段
+    current_task->chunks.close();
+    current_task->close_received();
+    close_pending_tail();
     EventReadFinshed.set();
     EventFeedDecoder.reset();
     return true;
 }
 
+void AudioSender::close_pending_tail() {
+    std::lock_guard<std::mutex> tail_lock(tail_mutex_);
+    if (pending_tail_) {
+        pending_tail_->close();
+    }
+}
+
 void AudioSender::clean_up() {
+    close_pending_tail();
     EventReadFinshed.set();
     EventNewDownload.set();
     EventFeedDecoder.set();
     audio_props.play_state = PLAYING;
+    publish_stats();
     EventStateUpdate.set();
-    rb.notify_waiters();
+    pcm_ring_.close();
+    rb.close();
 }
 
 bool AudioSender::switchPlayState(::PlayState state) {
@@ -203,6 +329,7 @@ bool AudioSender::switchPlayState(::PlayState state) {
     }
 
     audio_props.play_state = state;
+    publish_stats();
     EventStateUpdate.set();
     return true;
 }
@@ -214,16 +341,23 @@ bool AudioSender::setVolume(float volume) {
 
     // 四舍五入到两位小数
     audio_props.volume = std::round(volume * 100.0f) / 100.0f;
+    publish_stats();
     return true;
 }
 
 bool AudioSender::seekSecond(int seconds) {
-    if (task == nullptr) {
-        return false;
+    {
+        std::lock_guard<std::mutex> decoder_lock(decoder_mutex_);
+        if (task == nullptr || using_decoder == nullptr) {
+            return false;
+        }
+        using_decoder->seek(seconds);
+        audio_props.current_samples = using_decoder->getCurrentSamples();
     }
-
-    using_decoder->seek(seconds);
-    audio_props.current_samples = using_decoder->getCurrentSamples();
+    publish_stats();
     audio_props.do_empty_ring_buffer = true;
+    flush_pcm_ring_ = true;
+    flush_passthrough_ = true;
+    pcm_ring_.notify_data();
     return true;
 }
@@ -1,64 +1,158 @@
 #include "AudioSender.h"
+#include <chrono>
 
-coro::task<int> AudioSender::encode_opus_frame(OpusEncoder *encoder, int16_t *pcm_data, size_t total_samples,
-                                               OpusTempBuffer &temp_buffer, int max_data_bytes) {
-    size_t wantedSamples = OPUS_FRAMESIZE * audio_props.channels;
-    int total_encoded_bytes = 0;
+// 编码单帧：先应用调节器给出的目标复杂度，再统计本帧编码耗时上报给调节器
+int AudioSender::encode_single_frame(OpusEncoder *encoder, const int16_t *pcm, unsigned char *out, int max_bytes) {
+    int target = governor_entry_->target.load(std::memory_order_relaxed);
+    if (target != governor_entry_->applied) {
+        opus_encoder_ctl(encoder, OPUS_SET_COMPLEXITY(target));
+        governor_entry_->applied = target;
+    }
 
-    std::vector<uint8_t> encoded_frame(max_data_bytes);
+    auto encode_start = std::chrono::steady_clock::now();
+    int encoded_bytes = opus_encode(encoder, pcm, opus_framesize_, out, max_bytes);
+    auto encode_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - encode_start).count();
+    OpusComplexityGovernor::getInstance().reportEncode(encode_ns);
+    metrics_.observe(StreamMetrics::EncodeTime, static_cast<uint64_t>(encode_ns / 1000));
+    metrics_.add(StreamMetrics::FramesEncoded, 1);
+    return encoded_bytes;
+}
 
-    // 当总样本数和缓冲区的样本数足够时，进行编码
-    while (total_samples + temp_buffer.temp_samples >= wantedSamples) {
-        if (temp_buffer.temp_samples > 0) {
-            // 将 PCM 数据填充到临时缓冲区进行编码
-            size_t needed = wantedSamples - temp_buffer.temp_samples;
-            std::memcpy(temp_buffer.temp_buffer.data() + temp_buffer.temp_samples, pcm_data, needed * sizeof(int16_t));
+coro::task<void> AudioSender::emit_encoded_frame(const uint8_t *data, int len) {
+    if (frames_per_packet_ <= 1) {
+        co_await rb.push(*tp_, OpusPacket{std::vector<uint8_t>(data, data + len), 1});
+        co_return;
+    }
 
-            pcm_data += needed;
-            total_samples -= needed;
+    // code 3 包头：TOC + 帧数各 1 字节，VBR 下除最后一帧外每帧最多 2 字节长度，追加后超过 MTU 就先发出已攒的帧
+    if (pending_count_ > 0 && pending_bytes_ + len + 2 + 2 * pending_count_ > MAX_RTP_PAYLOAD) {
+        co_await flush_pending_frames();
+    }
 
-            int encoded_bytes = opus_encode(encoder, temp_buffer.temp_buffer.data(), OPUS_FRAMESIZE,
-                                            encoded_frame.data(), max_data_bytes - total_encoded_bytes);
-            if (encoded_bytes < 0) {
-                co_return encoded_bytes; // 编码错误处理
-            }
-            encoded_frame.resize(encoded_bytes);
-            co_await rb.produce(encoded_frame);
-
-            /* int write_err = ope_encoder_write(enc, temp_buffer.temp_buffer.data(), OPUS_FRAMESIZE);
-            if (write_err) {
-                LOGE << "写入文件错误";
-            }*/
-
-            total_encoded_bytes += encoded_bytes;
-            temp_buffer.temp_samples = 0; // 编码完成后重置临时样本数
-        } else {
-            // 直接从 pcm_data 进行编码
-            int encoded_bytes = opus_encode(encoder, pcm_data, OPUS_FRAMESIZE, encoded_frame.data(),
-                                            max_data_bytes - total_encoded_bytes);
-            if (encoded_bytes < 0) {
-                co_return encoded_bytes; // 编码错误处理
-            }
-            encoded_frame.resize(encoded_bytes);
-            co_await rb.produce(encoded_frame);
+    auto &slot = pending_frames_[pending_count_];
+    slot.assign(data, data + len);
+    if (pending_count_ == 0) {
+        opus_repacketizer_init(opus_repacketizer_);
+    }
+    if (opus_repacketizer_cat(opus_repacketizer_, slot.data(), len) != OPUS_OK) {
+        if (pending_count_ == 0) {
+            // 单独一帧都无法放入，直接原样发送
+            co_await rb.push(*tp_, OpusPacket{slot, 1});
+            co_return;
+        }
+        // TOC 不一致（编码器切换了模式或带宽），无法合并，先发出已攒的帧再以本帧开新包
+        co_await flush_pending_frames();
+        std::swap(pending_frames_[0], slot);
+        opus_repacketizer_init(opus_repacketizer_);
+        opus_repacketizer_cat(opus_repacketizer_, pending_frames_[0].data(), len);
+    }
+    pending_count_++;
+    pending_bytes_ += len;
 
-            /* int write_err = ope_encoder_write(enc, pcm_data, OPUS_FRAMESIZE);
-            if (write_err) {
-                LOGE << "写入文件错误";
-            }*/
+    if (pending_count_ >= frames_per_packet_) {
+        co_await flush_pending_frames();
+    }
+}
+
+coro::task<void> AudioSender::flush_pending_frames() {
+    if (pending_count_ == 0) {
+        co_return;
+    }
+    int frames = pending_count_;
+    pending_count_ = 0;
+    pending_bytes_ = 0;
 
-            total_encoded_bytes += encoded_bytes;
-            pcm_data += wantedSamples;
-            total_samples -= wantedSamples;
+    if (frames == 1) {
+        co_await rb.push(*tp_, OpusPacket{pending_frames_[0], 1});
+        co_return;
+    }
+
+    std::vector<uint8_t> packet(MAX_RTP_PAYLOAD);
+    opus_int32 packet_len = opus_repacketizer_out(opus_repacketizer_, packet.data(), MAX_RTP_PAYLOAD);
+    if (packet_len < 0) {
+        // 合并失败时退回逐帧发送，保证时间戳连续
+        LOG(ERROR) << "Opus 多帧打包失败: " << opus_strerror(packet_len);
+        for (int i = 0; i < frames; ++i) {
+            co_await rb.push(*tp_, OpusPacket{pending_frames_[i], 1});
         }
+        co_return;
     }
+    packet.resize(packet_len);
+    co_await rb.push(*tp_, OpusPacket{std::move(packet), frames});
+}
 
-    // Cache remaining samples if any
-    if (total_samples > 0) {
-        std::memcpy(temp_buffer.temp_buffer.data() + temp_buffer.temp_samples, pcm_data,
-                    total_samples * sizeof(int16_t));
-        temp_buffer.temp_samples += total_samples;
+coro::task<void> AudioSender::forward_passthrough_packets(std::vector<int16_t> &frame,
+                                                          std::vector<uint8_t> &encoded_frame) {
+    // 解码阶段切到直通前已经等 PCM 消费到不足一帧，剩下的尾巴补静音编成一帧，避免留到之后的转码段里
+    size_t leftover = pcm_ring_.size();
+    if (leftover > 0) {
+        size_t wanted_samples = static_cast<size_t>(opus_framesize_) * ENCODER_CHANNELS;
+        std::fill(frame.begin(), frame.begin() + wanted_samples, 0);
+        pcm_ring_.read(frame.data(), std::min(leftover, wanted_samples));
+        pcm_ring_.notify_space();
+        int encoded_bytes = encode_single_frame(opus_encoder_, frame.data(), encoded_frame.data(),
+                                                MAX_OPUS_PACKET_SIZE);
+        if (encoded_bytes > 0) {
+            co_await emit_encoded_frame(encoded_frame.data(), encoded_bytes);
+        }
     }
+    co_await flush_pending_frames();
 
-    co_return total_encoded_bytes;
+    while (auto packet = passthrough_ring_.try_pop()) {
+        passthrough_ring_.notify_space();
+        co_await rb.push(*tp_, std::move(*packet));
+    }
+}
+
+// 编码阶段：运行在 CPU 线程池上，与解码、发送各自独立推进，不持有下载数据锁
+coro::task<void> AudioSender::start_encoder(const bool &isStopped) {
+    co_await tp_->schedule();
+
+    std::vector<int16_t> frame(MAX_OPUS_FRAMESIZE * ENCODER_CHANNELS);
+    std::vector<uint8_t> encoded_frame(MAX_OPUS_PACKET_SIZE);
+
+    while (true) {
+        if (flush_pcm_ring_.exchange(false)) {
+            // seek 之后旧的 PCM 与待合并帧都已作废
+            pcm_ring_.clear();
+            pcm_ring_.notify_space();
+            pending_count_ = 0;
+            pending_bytes_ = 0;
+            passthrough_ring_.clear();
+            passthrough_ring_.notify_space();
+        }
+
+        size_t wanted_samples = static_cast<size_t>(opus_framesize_) * ENCODER_CHANNELS;
+        if (pcm_ring_.size() < wanted_samples) {
+            if (!passthrough_ring_.empty()) {
+                co_await forward_passthrough_packets(frame, encoded_frame);
+                continue;
+            }
+            if (flush_tail_frames_.exchange(false)) {
+                co_await flush_pending_frames();
+            }
+            if (isStopped) {
+                VLOG(1) << "编码阶段退出";
+                co_return;
+            }
+            // 直通包到达时解码阶段也会通知 pcm_ring_，一并唤醒
+            if (!co_await pcm_ring_.wait_for_data(*tp_, wanted_samples,
+                                                  [this] { return !passthrough_ring_.empty(); })) {
+                co_return;
+            }
+            continue;
+        }
+
+        pcm_ring_.read(frame.data(), wanted_samples);
+        pcm_ring_.notify_space();
+
+        int encoded_bytes = encode_single_frame(opus_encoder_, frame.data(), encoded_frame.data(),
+                                                MAX_OPUS_PACKET_SIZE);
+        if (encoded_bytes < 0) {
+            LOG(ERROR) << "Opus 编码错误: " << opus_strerror(encoded_bytes);
+            continue;
+        }
+        co_await emit_encoded_frame(encoded_frame.data(), encoded_bytes);
+    }
 }
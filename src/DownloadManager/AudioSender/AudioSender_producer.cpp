@@ -1,19 +1,17 @@
 #include "AudioSender.h"
 #include "AudioUtils.h"             // SIMD 优化函数
 #include "AudioAlignedAlloc.h"      // 自定义的对齐分配封装
+#include "../../ConfigManager.h"
 #include <samplerate.h>
 #include <memory>
 #include <vector>
 #include <algorithm>
 #include <cstring>
+#include <array>
 
 // AudioSender 类的其他成员和声明请参见 AudioSender.h
-// 主消费者协程：负责从解码器读取数据、处理转换、重采样、音量调整，并执行 Opus 编码
+// 解码阶段协程：负责从解码器读取数据、处理转换、重采样、音量调整，结果写入 pcm_ring_ 交给编码阶段
 coro::task<void> AudioSender::start_consumer(const bool &isStopped) {
-    // 创建 Opus 临时缓冲区
-    OpusTempBuffer opus_buffer(OPUS_FRAMESIZE * 2);
-    auto opus_output_buffer = std::make_unique<unsigned char[]>(MAX_DECODE_SIZE);
-
     int result = 0;
     size_t done = 0;
 
@@ -28,31 +26,81 @@ coro::task<void> AudioSender::start_consumer(const bool &isStopped) {
         // 协程让出执行权，避免长时间占用线程
         co_await EventFeedDecoder;
 
-        // 如果 task 为空，则重置解码事件，防止异常状态
-        if (task == nullptr) {
+        // 如果 task 为空或尚未租到解码器，则重置解码事件，防止异常状态
+        if (task == nullptr || using_decoder == nullptr) {
             EventFeedDecoder.reset();
             continue;
         }
 
+        if (flush_passthrough_.exchange(false)) {
+            // seek 之后待合并的源包已作废
+            passthrough_pending_.clear();
+            passthrough_pending_samples_ = 0;
+            passthrough_pending_bytes_ = 0;
+        }
+
+        // 音量不为 1.0 时必须转码；只在没有待合并源包时切换，保证直通包都按发送帧长对齐
+        bool want_passthrough = audio_props.opus_passthrough && audio_props.volume == 1.0f;
+        if (want_passthrough != passthrough_active_ && passthrough_pending_.empty()) {
+            if (!co_await switch_passthrough(want_passthrough)) {
+                co_return;
+            }
+        }
+
+        bool decoder_released = false;
         {
-            // 等待解码器事件，并锁定数据以确保线程安全
-            co_await task->mutex_data.lock();
-            result = using_decoder->read(read_output_buffer_.get(), MAX_DECODE_SIZE, &done);
+            // 只在读取解码器时持有下载数据锁，后续处理与编码都不占用
+            auto lock = co_await task->mutex_data.lock();
+            task->drainChunks();
+            std::lock_guard<std::mutex> decoder_lock(decoder_mutex_);
+            if (using_decoder == nullptr) {
+                // 控制阶段已在等待期间归还解码器
+                decoder_released = true;
+            } else if (passthrough_active_) {
+                result = static_cast<FfmpegDecoder *>(using_decoder)->readPacket(passthrough_packet_);
+            } else {
+                result = using_decoder->read(read_output_buffer_.get(), MAX_DECODE_SIZE, &done);
+            }
+            if (chain_source_) {
+                // 读取不再消费链上的数据，流式下载时释放已读过的块，并按未读字节数上报背压
+                chain_source_->trim_consumed(STREAM_KEEP_BEHIND);
+                task->chunks.report_backlog(chain_source_->available());
+            }
+        }
+        if (decoder_released) {
+            EventFeedDecoder.reset();
+            continue;
         }
 
         // 根据解码器返回状态进行处理
         if (result == MPG123_DONE) {
             LOG(WARNING) << "读取完成";
             EventFeedDecoder.reset();
+            if (passthrough_active_) {
+                co_await flush_passthrough_pending();
+            }
+            // 曲目结束，让编码阶段把还在等待合并的尾帧发出去
+            flush_tail_frames_ = true;
+            pcm_ring_.notify_data();
             // 通知其他模块音频读取结束
             EventReadFinshed.set();
             co_await tp_->schedule();
             continue;
         }
         if (result == MPG123_NEED_MORE) {
-            EventFeedDecoder.reset();
             // 恢复下载
             curl_easy_pause(task->curl_handler.get(), CURLPAUSE_RECV_CONT);
+            if (task->isIOBufQueue() && !task->chunks.finished()) {
+                // 流式下载：挂起到 curl 线程发布下一块数据，由线程池恢复，不再依赖外部轮询
+                co_await task->chunks.wait_for_data(*tp_);
+                continue;
+            }
+            if (task->is_receiving()) {
+                // 整段缓冲区边下边解（例如 faststart 的 MP4）：登记字节阈值，下载侧再收到一段数据后唤醒
+                co_await task->wait_for_bytes(*tp_, task->received_bytes.load() + PROGRESSIVE_WAKE_BYTES);
+                continue;
+            }
+            EventFeedDecoder.reset();
             continue;
         }
         if (result == MPG123_ERR) {
@@ -63,12 +111,24 @@ coro::task<void> AudioSender::start_consumer(const bool &isStopped) {
             continue;
         }
 
+        if (passthrough_active_ && result == MPG123_OK) {
+            metrics_.add(StreamMetrics::DecodedBytes, passthrough_packet_.size());
+            metrics_.add(StreamMetrics::PassthroughBytes, passthrough_packet_.size());
+            if (!co_await queue_passthrough_packet(passthrough_packet_)) {
+                LOG(WARNING) << "Opus 源包帧长与发送帧长不匹配，本曲改为转码";
+                audio_props.opus_passthrough = false;
+            }
+            continue;
+        }
+
         // 当读取到音频数据（MPG123_OK 或 MPG123_NEW_FORMAT）
         if (result == MPG123_OK || result == MPG123_NEW_FORMAT) {
             int channelCount = audio_props.channels;
             // 根据字节数计算样本总数
             int totalSamples = static_cast<int>(done / audio_props.bytes_per_sample);
+            metrics_.add(StreamMetrics::DecodedBytes, done);
             audio_props.current_samples += totalSamples / channelCount;
+            publish_stats();
 
             int16_t *pcm_data = nullptr;
             // 判断是否需要重采样（目标采样率 TARGET_SAMPLE_RATE 在其他地方定义）
@@ -83,19 +143,10 @@ coro::task<void> AudioSender::start_consumer(const bool &isStopped) {
                 continue;
             }
 
-            // 计算每个声道的样本数
+            // 计算每个声道的样本数，写入 PCM 环形缓冲区，满时在这里等待编码阶段消费
             int samples_per_channel = totalSamples / channelCount;
-            // 执行 Opus 编码（encode_opus_frame 为异步接口）
-            auto encoded_length = co_await encode_opus_frame(
-                    opus_encoder_,
-                    pcm_data,
-                    samples_per_channel * channelCount,
-                    opus_buffer,
-                    MAX_DECODE_SIZE
-            );
-            if (encoded_length < 0) {
-                LOG(ERROR) << "Opus 编码错误: " << opus_strerror(encoded_length);
-                continue;
+            if (!co_await write_pcm(pcm_data, samples_per_channel, channelCount)) {
+                co_return;
             }
         }
     }
@@ -103,6 +154,251 @@ coro::task<void> AudioSender::start_consumer(const bool &isStopped) {
     co_return;
 }
 
+//------------------------------------------------------------------------------
+// Opus 直通
+// 源包帧长能整除发送帧长时合并到一个发送帧（或 frames_per_packet_ 个帧），是发送帧长的整数倍时原样转发，
+// 其余情况无法对齐 RTP 时间戳，只能转码
+//------------------------------------------------------------------------------
+bool AudioSender::can_passthrough_opus() {
+    if (!ConfigManager::getInstance().getConfig().opus_passthrough) {
+        return false;
+    }
+    auto *ffmpeg = dynamic_cast<FfmpegDecoder *>(using_decoder);
+    if (ffmpeg == nullptr || !ffmpeg->isOpusStream() || audio_props.rate != TARGET_SAMPLE_RATE) {
+        return false;
+    }
+    opus_int32 target_bitrate = 0;
+    opus_encoder_ctl(opus_encoder_, OPUS_GET_BITRATE(&target_bitrate));
+    int64_t source_bitrate = ffmpeg->sourceBitRate();
+    // 码率未知（例如仍在下载的 Ogg）时按可直通处理，容器开销允许 10% 余量
+    if (source_bitrate > 0 && target_bitrate > 0 && source_bitrate > target_bitrate * 11 / 10) {
+        VLOG(1) << "源 Opus 码率 " << source_bitrate << " 高于推流码率 " << target_bitrate << "，转码发送";
+        return false;
+    }
+    return true;
+}
+
+coro::task<bool> AudioSender::switch_passthrough(bool enable) {
+    if (enable) {
+        // 转码路径排空到不足一帧，剩余的尾巴由编码阶段补齐后先于直通包发出
+        size_t wanted_samples = static_cast<size_t>(opus_framesize_) * ENCODER_CHANNELS;
+        while (pcm_ring_.size() >= wanted_samples) {
+            if (!co_await pcm_ring_.wait_for_space(*tp_, pcm_ring_.capacity() - wanted_samples + 1)) {
+                co_return false;
+            }
+        }
+    } else {
+        while (!passthrough_ring_.empty()) {
+            if (!co_await passthrough_ring_.wait_for_space(*tp_, passthrough_ring_.capacity())) {
+                co_return false;
+            }
+        }
+    }
+    passthrough_active_ = enable;
+    VLOG(1) << (enable ? "切换到 Opus 直通" : "切换到转码");
+    co_return true;
+}
+
+coro::task<bool> AudioSender::queue_passthrough_packet(const std::vector<uint8_t> &packet) {
+    int samples = opus_packet_get_nb_samples(packet.data(), static_cast<opus_int32>(packet.size()), TARGET_SAMPLE_RATE);
+    if (samples <= 0) {
+        // 损坏的包直接丢弃
+        co_return true;
+    }
+    audio_props.current_samples += samples;
+    publish_stats();
+
+    if (samples % opus_framesize_ == 0 && passthrough_pending_.empty()) {
+        co_await passthrough_ring_.push(*tp_, OpusPacket{packet, samples / opus_framesize_});
+        pcm_ring_.notify_data();
+        co_return true;
+    }
+    if (opus_framesize_ % samples != 0) {
+        co_await flush_passthrough_pending();
+        co_return false;
+    }
+
+    // 攒到帧边界且再追加会超过 MTU 时先发出
+    bool aligned = passthrough_pending_samples_ % opus_framesize_ == 0;
+    int count = static_cast<int>(passthrough_pending_.size());
+    if (count > 0 && aligned &&
+        passthrough_pending_bytes_ + static_cast<int>(packet.size()) + 2 + 2 * count > MAX_RTP_PAYLOAD) {
+        co_await flush_passthrough_pending();
+    }
+
+    if (passthrough_pending_.empty()) {
+        opus_repacketizer_init(passthrough_repacketizer_);
+    }
+    passthrough_pending_.push_back(packet);
+    if (opus_repacketizer_cat(passthrough_repacketizer_, passthrough_pending_.back().data(),
+                              static_cast<opus_int32>(packet.size())) != OPUS_OK) {
+        // TOC 不一致无法合并，已攒的部分先发出，本包另起一组
+        auto current = std::move(passthrough_pending_.back());
+        passthrough_pending_.pop_back();
+        co_await flush_passthrough_pending();
+        opus_repacketizer_init(passthrough_repacketizer_);
+        passthrough_pending_.push_back(std::move(current));
+        opus_repacketizer_cat(passthrough_repacketizer_, passthrough_pending_.back().data(),
+                              static_cast<opus_int32>(passthrough_pending_.back().size()));
+    }
+    passthrough_pending_samples_ += samples;
+    passthrough_pending_bytes_ += static_cast<int>(packet.size());
+
+    if (passthrough_pending_samples_ >= opus_framesize_ * frames_per_packet_ &&
+        passthrough_pending_samples_ % opus_framesize_ == 0) {
+        co_await flush_passthrough_pending();
+    }
+    co_return true;
+}
+
+coro::task<void> AudioSender::flush_passthrough_pending() {
+    if (passthrough_pending_.empty()) {
+        co_return;
+    }
+    // 曲目结尾或 TOC 变化时可能不足整帧，按向上取整计帧，发送端的时间戳因此留出一小段空隙
+    int frames = std::max(1, (passthrough_pending_samples_ + opus_framesize_ - 1) / opus_framesize_);
+    OpusPacket out{{}, frames};
+    if (passthrough_pending_.size() == 1) {
+        out.data = std::move(passthrough_pending_.front());
+    } else {
+        out.data.resize(MAX_RTP_PAYLOAD);
+        opus_int32 len = opus_repacketizer_out(passthrough_repacketizer_, out.data.data(), MAX_RTP_PAYLOAD);
+        if (len < 0) {
+            LOG(ERROR) << "Opus 直通打包失败: " << opus_strerror(len);
+            out.data.clear();
+        } else {
+            out.data.resize(len);
+        }
+    }
+    passthrough_pending_.clear();
+    passthrough_pending_samples_ = 0;
+    passthrough_pending_bytes_ = 0;
+
+    if (!out.data.empty()) {
+        co_await passthrough_ring_.push(*tp_, std::move(out));
+        pcm_ring_.notify_data();
+    }
+}
+
+namespace {
+    struct DownmixGain {
+        float left;
+        float right;
+    };
+
+    // 多声道缩混为立体声时各声道的左右增益，按 FFmpeg 默认声道顺序（FL FR FC LFE BL BR SL SR），丢弃 LFE；
+    // 超过 8 声道时只保留前两个声道。增益按单侧总和归一化，缩混后不会削波
+    std::vector<DownmixGain> downmix_gains(int channels) {
+        constexpr float C = 0.7071f;
+        std::vector<DownmixGain> gains(channels, DownmixGain{0.0f, 0.0f});
+        gains[0] = {1.0f, 0.0f};
+        gains[1] = {0.0f, 1.0f};
+        switch (channels) {
+            case 3: // FL FR FC
+                gains[2] = {C, C};
+                break;
+            case 4: // FL FR BL BR
+                gains[2] = {C, 0.0f};
+                gains[3] = {0.0f, C};
+                break;
+            case 5: // FL FR FC BL BR
+                gains[2] = {C, C};
+                gains[3] = {C, 0.0f};
+                gains[4] = {0.0f, C};
+                break;
+            case 6: // FL FR FC LFE BL BR
+                gains[2] = {C, C};
+                gains[4] = {C, 0.0f};
+                gains[5] = {0.0f, C};
+                break;
+            case 7: // FL FR FC LFE BC SL SR
+                gains[2] = {C, C};
+                gains[4] = {C, C};
+                gains[5] = {C, 0.0f};
+                gains[6] = {0.0f, C};
+                break;
+            case 8: // FL FR FC LFE BL BR SL SR
+                gains[2] = {C, C};
+                gains[4] = {C, 0.0f};
+                gains[5] = {0.0f, C};
+                gains[6] = {C, 0.0f};
+                gains[7] = {0.0f, C};
+                break;
+            default:
+                break;
+        }
+        float sum = 0.0f;
+        for (const auto &gain: gains) {
+            sum += gain.left;
+        }
+        for (auto &gain: gains) {
+            gain.left /= sum;
+            gain.right /= sum;
+        }
+        return gains;
+    }
+}
+
+//------------------------------------------------------------------------------
+// 辅助函数：写入 PCM 环形缓冲区
+// 编码器固定为立体声，单声道数据在这里复制为双声道，多声道数据先缩混为双声道
+// 返回值：false 表示环形缓冲区已关闭（流正在销毁）
+//------------------------------------------------------------------------------
+coro::task<bool> AudioSender::write_pcm(const int16_t *pcm_data, int samples_per_channel, int channelCount) {
+    if (channelCount > ENCODER_CHANNELS) {
+        // 原样写入会被编码器当成交错的立体声，声音完全错乱
+        auto gains = downmix_gains(channelCount);
+        std::array<int16_t, 2048> stereo{};
+        int offset = 0;
+        while (offset < samples_per_channel) {
+            int count = std::min<int>(samples_per_channel - offset, stereo.size() / 2);
+            for (int i = 0; i < count; ++i) {
+                const int16_t *in = pcm_data + static_cast<size_t>(offset + i) * channelCount;
+                float left = 0.0f;
+                float right = 0.0f;
+                for (int c = 0; c < channelCount; ++c) {
+                    left += in[c] * gains[c].left;
+                    right += in[c] * gains[c].right;
+                }
+                stereo[2 * i] = static_cast<int16_t>(std::clamp(left, -32768.0f, 32767.0f));
+                stereo[2 * i + 1] = static_cast<int16_t>(std::clamp(right, -32768.0f, 32767.0f));
+            }
+            if (!co_await write_pcm(stereo.data(), count, ENCODER_CHANNELS)) {
+                co_return false;
+            }
+            offset += count;
+        }
+        co_return true;
+    }
+
+    if (channelCount == 1) {
+        std::array<int16_t, 2048> stereo{};
+        int offset = 0;
+        while (offset < samples_per_channel) {
+            int count = std::min<int>(samples_per_channel - offset, stereo.size() / 2);
+            for (int i = 0; i < count; ++i) {
+                stereo[2 * i] = stereo[2 * i + 1] = pcm_data[offset + i];
+            }
+            if (!co_await write_pcm(stereo.data(), count, ENCODER_CHANNELS)) {
+                co_return false;
+            }
+            offset += count;
+        }
+        co_return true;
+    }
+
+    size_t total = static_cast<size_t>(samples_per_channel) * channelCount;
+    size_t written = 0;
+    while (written < total) {
+        written += pcm_ring_.write(pcm_data + written, total - written);
+        pcm_ring_.notify_data();
+        if (written < total && !co_await pcm_ring_.wait_for_space(*tp_)) {
+            co_return false;
+        }
+    }
+    co_return true;
+}
+
 //------------------------------------------------------------------------------
 // 辅助函数：重采样处理
 // 将 float_buffer_ 中的音频数据进行重采样，并转换为 int16_t，同时应用音量调整
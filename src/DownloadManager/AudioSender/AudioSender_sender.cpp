@@ -12,8 +12,28 @@ using TimePoint = std::chrono::time_point<Clock>;
 /**
  * AudioSender::start_sender
  *
+ * 根据本流配置的帧时长选择对应的编译期特化发送循环。
+ */
+coro::task<void> AudioSender::start_sender(const bool &isStopped) {
+    switch (opus_delay_) {
+        case 10:
+            return run_sender<10>(isStopped);
+        case 20:
+            return run_sender<20>(isStopped);
+        case 60:
+            return run_sender<60>(isStopped);
+        case 40:
+        default:
+            return run_sender<40>(isStopped);
+    }
+}
+
+/**
+ * AudioSender::run_sender
+ *
  * 协程函数：持续从环形缓冲区 rb 中获取音频帧并发送到 RTP 流。
  *
+ * @tparam FrameMs 每帧时长（毫秒），决定 RTP 时间戳增量与发送节奏。
  * @param isStopped 标志是否停止采集/生产帧。如果为 true 且缓冲区空，则发送协程退出。
  *
  * 主要流程：
@@ -23,7 +43,8 @@ using TimePoint = std::chrono::time_point<Clock>;
  * 4. 使用移动平均动态调整 current_advance_frames，以控制发送速率与延迟。
  * 5. 检测到停止条件 (isStopped && 缓冲为空) 后安全退出协程。
  */
-coro::task<void> AudioSender::start_sender(const bool &isStopped) {
+template<int FrameMs>
+coro::task<void> AudioSender::run_sender(const bool &isStopped) {
     // 先让协程挂起一帧时间，方便初始化
     co_await scheduler_->schedule();
     co_await scheduler_->yield_for(std::chrono::milliseconds{1000});
@@ -31,16 +52,17 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
     // RTP 相关信息
     auto rtpInstance = rtp_instance_.get();
     auto main_stream = rtpInstance->getMainStream();
-    auto timestamp = rtpInstance->getMainStreamTimestamp();
+    // 从快照恢复时沿用停机前的时间戳，接收端看到的是一段静音而不是时间戳跳回
+    auto timestamp = initial_timestamp_.value_or(rtpInstance->getMainStreamTimestamp());
 
     // OPUS 相关常量
-    constexpr int OPUS_DELAY_MS = OPUS_DELAY;       // 每帧时长 (毫秒)
+    constexpr int OPUS_DELAY_MS = FrameMs;       // 每帧时长 (毫秒)
     constexpr int OPUS_DELAY_US = OPUS_DELAY_MS * 1000;
-    constexpr int OPUS_RTP_FRAMESIZE = OPUS_FRAMESIZE;   // RTP 时间戳增量
+    constexpr int OPUS_RTP_FRAMESIZE = TARGET_SAMPLE_RATE / 1000 * FrameMs;   // RTP 时间戳增量
 
-    // 动态提前发送帧数相关
-    constexpr int MAX_ADVANCE_FRAMES = 4;  // 最大提前发送帧数
-    constexpr int MIN_ADVANCE_FRAMES = 2;  // 最小提前发送帧数
+    // 动态提前发送帧数相关，按帧时长换算，保持约 80ms ~ 160ms 的提前量
+    constexpr int MAX_ADVANCE_FRAMES = std::max(2, 160 / FrameMs);  // 最大提前发送帧数
+    constexpr int MIN_ADVANCE_FRAMES = std::max(1, 80 / FrameMs);  // 最小提前发送帧数
     constexpr int ADJUSTMENT_STEP_FRAMES = 1;  // 调整步长
     constexpr int MOVING_AVERAGE_SIZE = 5;  // 移动平均窗口大小
 
@@ -59,6 +81,9 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
     int total_send_duration_us = 0; // 移动平均的总和
     int count = 0;                 // 已累积的样本数
 
+    // 缺包统计：从有包变为到点无包时记一次，启动时视为已缺包，不计入
+    bool starved = true;
+
     while (true) {
         // ========== (1) 处理暂停与清空缓冲的请求 ==========
         while (audio_props.play_state == PAUSE) {
@@ -67,10 +92,9 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
             EventStateUpdate.reset();
         }
         if (audio_props.do_empty_ring_buffer) {
-            // 需要清空环形缓冲
-            while (!rb.empty()) {
-                co_await rb.consume();
-            }
+            // 需要清空环形缓冲（发送阶段是 rb 的唯一消费者，可以直接丢弃）
+            rb.clear();
+            rb.notify_space();
             audio_props.do_empty_ring_buffer = false;
         }
 
@@ -86,24 +110,35 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
 
         if (now < expected_send_time) {
             // 还未到发送时间，等待
+            metrics_.observe(StreamMetrics::SendLateness, 0);
             co_await scheduler_->yield_until(expected_send_time);
         } else {
             // 说明已经比期望时间晚了，需要计算落后了多少帧
-            auto delay_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            auto delay_us = std::chrono::duration_cast<std::chrono::microseconds>(
                     now - expected_send_time).count();
-            int frames_late = delay_ms / OPUS_DELAY_MS;
+            metrics_.observe(StreamMetrics::SendLateness, static_cast<uint64_t>(delay_us));
+            int frames_late = static_cast<int>(delay_us / 1000 / OPUS_DELAY_MS);
             if (frames_late > 0) {
+                metrics_.add(StreamMetrics::FramesLate, frames_late);
                 // 如果落后了 frames_late 帧，则跳过相应的帧计数与 RTP 时间戳
                 frame_index += frames_late;
                 timestamp += frames_late * OPUS_RTP_FRAMESIZE;
+                // 发送已落后于实时，报告给复杂度调节器，足够多的流落后时才会降低编码负载
+                OpusComplexityGovernor::getInstance().reportLate(*governor_entry_, frames_late);
             }
         }
 
         // ========== (3) 动态等待与批量发送 ==========
         size_t available_frames = rb.size();
+        if (available_frames == 0 && !starved) {
+            starved = true;
+            stats_.underruns.fetch_add(1, std::memory_order_relaxed);
+        } else if (available_frames > 0) {
+            starved = false;
+        }
         if (available_frames == 0) {
             // 缓冲区为空：先等待至少一帧，避免 std::min(...) 为 0
-            auto maybe_frame = co_await rb.consume();
+            auto maybe_frame = co_await rb.pop(*scheduler_);
             if (!maybe_frame) {
                 // 消费者被关闭（极端情况）
                 LOG(ERROR) << "消费者关闭，无法获取更多音频帧，退出协程。";
@@ -116,23 +151,25 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
                 co_return;
             }
 
-            // 仅发送这一帧
-            std::vector<unsigned char> single_frame = std::move(*maybe_frame);
+            // 仅发送这一个包（可能包含多帧）
+            OpusPacket single_packet = std::move(*maybe_frame);
 
             // 记录发送开始时间
             auto batch_send_start = Clock::now();
             // 发送
-            int result = main_stream->push_frame(single_frame.data(),
-                                                 single_frame.size(),
+            int result = main_stream->push_frame(single_packet.data.data(),
+                                                 single_packet.data.size(),
                                                  timestamp,
                                                  RTP_NO_FLAGS);
             if (result != RTP_OK) {
                 LOG(ERROR) << "发送遇到错误(单帧)";
             }
 
-            // 更新时间戳 & 帧计数
-            timestamp += OPUS_RTP_FRAMESIZE;
-            frame_index += 1;
+            // 更新时间戳 & 帧计数，按包内帧数推进
+            timestamp += OPUS_RTP_FRAMESIZE * single_packet.frames;
+            frame_index += single_packet.frames;
+            stats_.rtp_timestamp.store(timestamp, std::memory_order_relaxed);
+            metrics_.add(StreamMetrics::FramesSent, single_packet.frames);
 
             // 统计本次发送耗时（只有 1 帧的情况）
             auto batch_send_end = Clock::now();
@@ -180,11 +217,12 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
         }
 
         // 如果缓冲区中有帧，可以批量发送
-        // 确定本次要发送的帧数：取 current_advance_frames 和 available_frames 的最小值
-        int batch_frames = std::min<int>(current_advance_frames, static_cast<int>(available_frames));
+        // 确定本次要发送的包数：提前量按帧计，多帧打包时换算成包数，再与 available_frames 取最小值
+        int advance_packets = std::max(1, current_advance_frames / frames_per_packet_);
+        int batch_frames = std::min<int>(advance_packets, static_cast<int>(available_frames));
 
         // 预分配空间，减少内存开销
-        std::vector<std::vector<unsigned char>> frames_to_send;
+        std::vector<OpusPacket> frames_to_send;
         frames_to_send.reserve(batch_frames);
 
         // 批量消费
@@ -194,7 +232,7 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
                 LOG(INFO) << "生产者已停止且缓冲区为空，退出发送器。";
                 co_return;
             }
-            auto maybe_frame = co_await rb.consume();
+            auto maybe_frame = co_await rb.pop(*scheduler_);
             if (!maybe_frame) {
                 // 消费者关闭
                 LOG(ERROR) << "消费者关闭，无法再获取帧，退出协程。";
@@ -205,10 +243,11 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
 
         // ========== (4) 发送批量帧，统计发送耗时 ==========
         auto batch_send_start = Clock::now();
-        for (auto &frame: frames_to_send) {
+        int batch_start_frame = frame_index;
+        for (auto &packet: frames_to_send) {
             int result = main_stream->push_frame(
-                    frame.data(),
-                    frame.size(),
+                    packet.data.data(),
+                    packet.data.size(),
                     timestamp,
                     RTP_NO_FLAGS
             );
@@ -217,9 +256,11 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
                 // 可以考虑是否要 continue，或根据需求 break
                 continue;
             }
-            timestamp += OPUS_RTP_FRAMESIZE;
-            frame_index++;
+            timestamp += OPUS_RTP_FRAMESIZE * packet.frames;
+            frame_index += packet.frames;
         }
+        stats_.rtp_timestamp.store(timestamp, std::memory_order_relaxed);
+        metrics_.add(StreamMetrics::FramesSent, frame_index - batch_start_frame);
         auto batch_send_end = Clock::now();
 
         // 计算批量发送时长（微秒）
@@ -268,8 +309,8 @@ coro::task<void> AudioSender::start_sender(const bool &isStopped) {
                                             MAX_ADVANCE_FRAMES);
 
         // 记录日志，可根据需要调整 VLOG 级别或使用其他日志方式
-        VLOG(2) << "批次开始帧 " << (frame_index - frames_to_send.size())
-                << " ，发送了 " << frames_to_send.size() << " 帧"
+        VLOG(2) << "批次开始帧 " << batch_start_frame
+                << " ，发送了 " << frames_to_send.size() << " 包 " << (frame_index - batch_start_frame) << " 帧"
                 << " ，当前提前 " << current_advance_frames * OPUS_DELAY_MS << "ms"
                 << " ，平均批量发送耗时 " << average_send_duration_us << "us";
     } // while(true)
@@ -0,0 +1,137 @@
+#include "OpusComplexityGovernor.h"
+#include "../../ConfigManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <glog/logging.h>
+
+static int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            OpusComplexityGovernor::Clock::now().time_since_epoch()).count();
+}
+
+OpusComplexityGovernor &OpusComplexityGovernor::getInstance() {
+    static OpusComplexityGovernor instance;
+    return instance;
+}
+
+OpusComplexityGovernor::OpusComplexityGovernor()
+        : cpu_threads_(std::max(1, ConfigManager::getInstance().getConfig().num_threads)),
+          window_start_ns_(now_ns()) {}
+
+std::shared_ptr<OpusComplexityGovernor::Entry> OpusComplexityGovernor::registerStream(const std::string &stream_id) {
+    auto entry = std::make_shared<Entry>();
+    entry->stream_id = stream_id;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.push_back(entry);
+    return entry;
+}
+
+void OpusComplexityGovernor::unregisterStream(const std::shared_ptr<Entry> &entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(std::remove(entries_.begin(), entries_.end(), entry), entries_.end());
+}
+
+void OpusComplexityGovernor::setPolicy(Entry &entry, int priority, int floor) {
+    floor = std::clamp(floor, MIN_COMPLEXITY, MAX_COMPLEXITY);
+    entry.priority.store(priority, std::memory_order_relaxed);
+    entry.floor.store(floor, std::memory_order_relaxed);
+    if (entry.target.load(std::memory_order_relaxed) < floor) {
+        entry.target.store(floor, std::memory_order_relaxed);
+    }
+}
+
+void OpusComplexityGovernor::reportLate(Entry &entry, int frames_late) {
+    entry.late_frames.fetch_add(frames_late, std::memory_order_relaxed);
+}
+
+void OpusComplexityGovernor::reportEncode(int64_t encode_ns) {
+    window_encode_ns_.fetch_add(encode_ns, std::memory_order_relaxed);
+    window_frames_.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t now = now_ns();
+    int64_t start = window_start_ns_.load(std::memory_order_relaxed);
+    int64_t window_ns = now - start;
+    if (window_ns < std::chrono::duration_cast<std::chrono::nanoseconds>(WINDOW).count()) {
+        return;
+    }
+
+    // 只让一个编码线程负责本窗口的评估
+    if (!window_start_ns_.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        return;
+    }
+    evaluate(window_ns);
+}
+
+void OpusComplexityGovernor::evaluate(int64_t window_ns) {
+    int64_t encode_ns = window_encode_ns_.exchange(0, std::memory_order_relaxed);
+    int64_t frames = window_frames_.exchange(0, std::memory_order_relaxed);
+    double load = static_cast<double>(encode_ns) / (static_cast<double>(window_ns) * cpu_threads_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.empty()) {
+        return;
+    }
+
+    // 汇总本窗口各流的落后情况
+    int late = 0;
+    size_t late_streams = 0;
+    for (auto &entry: entries_) {
+        int entry_late = entry->late_frames.exchange(0, std::memory_order_relaxed);
+        if (entry_late > 0) {
+            late += entry_late;
+            late_streams++;
+        }
+    }
+    size_t needed_streams = std::max(std::min(LATE_MIN_STREAMS, entries_.size()),
+                                     static_cast<size_t>(std::ceil(entries_.size() * LATE_STREAM_FRACTION)));
+    bool widely_late = late_streams >= needed_streams ||
+                       (frames > 0 && static_cast<double>(late) / static_cast<double>(frames) > LATE_FRAME_RATIO);
+
+    bool overloaded = load > HIGH_LOAD || widely_late;
+    bool underloaded = load < LOW_LOAD && late == 0;
+    if (!overloaded && !underloaded) {
+        return;
+    }
+
+    // 按优先级排序：过载时从最低优先级开始降级，空闲时从最高优先级开始恢复
+    std::vector<Entry *> sorted;
+    sorted.reserve(entries_.size());
+    for (auto &entry: entries_) {
+        sorted.push_back(entry.get());
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [overloaded](const Entry *a, const Entry *b) {
+        int pa = a->priority.load(std::memory_order_relaxed);
+        int pb = b->priority.load(std::memory_order_relaxed);
+        return overloaded ? pa < pb : pa > pb;
+    });
+
+    // 每次评估只调整一个优先级档位，逐级收敛，避免全体同时抖动
+    int adjusted = 0;
+    std::optional<int> group_priority;
+    for (auto *entry: sorted) {
+        int priority = entry->priority.load(std::memory_order_relaxed);
+        if (group_priority && priority != *group_priority) {
+            break;
+        }
+
+        int target = entry->target.load(std::memory_order_relaxed);
+        int next = overloaded
+                   ? std::max(target - 1, entry->floor.load(std::memory_order_relaxed))
+                   : std::min(target + 1, MAX_COMPLEXITY);
+        if (next == target) {
+            continue;
+        }
+        entry->target.store(next, std::memory_order_relaxed);
+        group_priority = priority;
+        adjusted++;
+    }
+
+    if (adjusted > 0) {
+        VLOG(1) << "[OpusComplexityGovernor] 编码负载 " << load << "，落后帧 " << late << "（" << late_streams << " 条流），"
+                << (overloaded ? "降低" : "提高") << "优先级 " << *group_priority << " 的 " << adjusted
+                << " 条流的复杂度";
+    }
+}
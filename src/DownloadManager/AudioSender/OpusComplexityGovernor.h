@@ -0,0 +1,79 @@
+// OpusComplexityGovernor.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 全局 Opus 复杂度调节器（单例）
+ *        汇总所有编码器每帧的编码耗时，按窗口计算编码占用的 CPU 比例：
+ *        负载过高时优先降低低优先级流的复杂度，负载回落后再逐级恢复。
+ *        调节器只写入目标复杂度，真正的 opus_encoder_ctl 由编码线程自己执行，避免跨线程操作编码器。
+ */
+class OpusComplexityGovernor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr int MAX_COMPLEXITY = 10;
+    static constexpr int MIN_COMPLEXITY = 0;
+
+    // 每条流在调节器中的登记信息
+    struct Entry {
+        std::string stream_id;
+        std::atomic<int> priority{0};          // 数值越大越重要，越晚被降级
+        std::atomic<int> floor{MIN_COMPLEXITY}; // 该流允许的最低复杂度
+        std::atomic<int> target{MAX_COMPLEXITY}; // 调节器给出的目标复杂度
+        int applied = MAX_COMPLEXITY;           // 编码器当前实际使用的复杂度，仅编码线程访问
+        std::atomic<int> late_frames{0};        // 本窗口内该流发送落后跳过的帧数
+    };
+
+    static OpusComplexityGovernor &getInstance();
+
+    std::shared_ptr<Entry> registerStream(const std::string &stream_id);
+
+    void unregisterStream(const std::shared_ptr<Entry> &entry);
+
+    // 设置优先级与复杂度下限，目标复杂度会被立即钳制到下限之上
+    static void setPolicy(Entry &entry, int priority, int floor);
+
+    // 编码侧每编完一帧调用一次，记录本帧编码耗时
+    void reportEncode(int64_t encode_ns);
+
+    // 发送侧发现落后跳帧时调用。单条流落后（例如线程被临时挂起）不会影响其他房间，
+    // 只有足够多的流在同一窗口落后，或落后帧占编码帧的比例过高时才视为过载
+    void reportLate(Entry &entry, int frames_late);
+
+    OpusComplexityGovernor(const OpusComplexityGovernor &) = delete;
+
+    OpusComplexityGovernor &operator=(const OpusComplexityGovernor &) = delete;
+
+private:
+    OpusComplexityGovernor();
+
+    // 评估窗口长度
+    static constexpr std::chrono::milliseconds WINDOW{1000};
+    // 编码耗时占 CPU 线程池容量的比例超过 HIGH 时降级，低于 LOW 时升级
+    static constexpr double HIGH_LOAD = 0.60;
+    static constexpr double LOW_LOAD = 0.30;
+    // 同一窗口内落后的流至少占登记流数的该比例（且至少 LATE_MIN_STREAMS 条）才视为过载
+    static constexpr double LATE_STREAM_FRACTION = 0.10;
+    static constexpr size_t LATE_MIN_STREAMS = 2;
+    // 或者落后帧数占本窗口编码帧数的比例超过该值
+    static constexpr double LATE_FRAME_RATIO = 0.02;
+
+    void evaluate(int64_t window_ns);
+
+    unsigned int cpu_threads_;
+
+    std::atomic<int64_t> window_encode_ns_{0};
+    std::atomic<int64_t> window_start_ns_;
+    std::atomic<int64_t> window_frames_{0};
+
+    std::mutex mutex_; // 保护 entries_，仅在登记与评估时加锁
+    std::vector<std::shared_ptr<Entry>> entries_;
+};
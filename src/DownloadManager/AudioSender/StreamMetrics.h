@@ -0,0 +1,102 @@
+// StreamMetrics.h
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 单条流的性能指标：计数器与直方图
+ *        按线程分片存放，写入方只对当前线程所在的分片做 relaxed 原子加，同一流水线阶段在线程池上迁移也不会争用同一缓存行；
+ *        GetMetrics 抓取时把所有分片合并，合并结果只保证单调，不保证各指标来自同一时刻。
+ */
+class StreamMetrics {
+public:
+    enum Counter : int {
+        DecodedBytes,     // 解码阶段输出的字节数：转码时为 PCM，直通时为 Opus 源包
+        PassthroughBytes, // 其中直通的 Opus 源包字节数
+        DownloadedBytes,  // curl 收到的字节数
+        FramesEncoded,
+        FramesSent,
+        FramesLate,       // 发送落后于实时而跳过的帧数
+        CounterCount
+    };
+
+    enum Histogram : int {
+        EncodeTime,       // 单帧 Opus 编码耗时
+        SendLateness,     // 实际发送时刻晚于计划时刻的时长，按时发送记为 0
+        HistogramCount
+    };
+
+    // 直方图桶上界（微秒），最后隐含一个 +Inf 桶
+    static constexpr std::array<uint64_t, 12> BUCKET_BOUNDS_US = {
+            50, 100, 250, 500, 1000, 2500, 5000, 10000, 20000, 40000, 80000, 160000
+    };
+    static constexpr size_t BUCKET_COUNT = BUCKET_BOUNDS_US.size() + 1;
+    static constexpr size_t SHARDS = 16;
+
+    struct HistogramSnapshot {
+        std::array<uint64_t, BUCKET_COUNT> buckets{}; // 各桶自身的计数，未累加
+        uint64_t sum_us = 0;
+        uint64_t count = 0;
+    };
+
+    void add(Counter counter, uint64_t value) {
+        shard().counters[counter].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void observe(Histogram histogram, uint64_t value_us) {
+        auto &cell = shard().histograms[histogram];
+        size_t bucket = std::lower_bound(BUCKET_BOUNDS_US.begin(), BUCKET_BOUNDS_US.end(), value_us) -
+                        BUCKET_BOUNDS_US.begin();
+        cell.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+        cell.sum_us.fetch_add(value_us, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] uint64_t counter(Counter counter) const {
+        uint64_t total = 0;
+        for (const auto &s: shards_) {
+            total += s.counters[counter].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    [[nodiscard]] HistogramSnapshot histogram(Histogram histogram) const {
+        HistogramSnapshot snapshot;
+        for (const auto &s: shards_) {
+            const auto &cell = s.histograms[histogram];
+            for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+                snapshot.buckets[i] += cell.buckets[i].load(std::memory_order_relaxed);
+            }
+            snapshot.sum_us += cell.sum_us.load(std::memory_order_relaxed);
+        }
+        for (auto bucket: snapshot.buckets) {
+            snapshot.count += bucket;
+        }
+        return snapshot;
+    }
+
+private:
+    struct HistogramCell {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+        std::atomic<uint64_t> sum_us{0};
+    };
+
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, CounterCount> counters{};
+        std::array<HistogramCell, HistogramCount> histograms{};
+    };
+
+    // 每个线程第一次写入时领取一个分片编号，之后固定不变
+    static size_t thread_slot() {
+        static std::atomic<size_t> next_slot{0};
+        thread_local const size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+        return slot;
+    }
+
+    Shard &shard() { return shards_[thread_slot()]; }
+
+    std::array<Shard, SHARDS> shards_{};
+};
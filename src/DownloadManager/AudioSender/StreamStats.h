@@ -0,0 +1,20 @@
+// StreamStats.h
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief 单条流对外可见的运行状态
+ *        各流水线阶段在状态变化时用 relaxed 原子写入，GetAllStreams 等批量查询直接读取，不经过任何锁，
+ *        读到的各字段之间不保证来自同一时刻，只用于监控展示。
+ */
+struct StreamStats {
+    std::atomic<uint32_t> time_played_ms{0};
+    std::atomic<uint32_t> time_total_ms{0};
+    std::atomic<uint8_t> play_state{0};
+    std::atomic<float> volume{1.0f};
+    std::atomic<int32_t> bitrate{0};
+    std::atomic<uint64_t> underruns{0}; // 发送阶段到点却没有可发的包的次数（连续缺包只算一次）
+    std::atomic<uint32_t> rtp_timestamp{0}; // 下一个包将使用的 RTP 时间戳
+};
@@ -1,9 +1,7 @@
 // AudioDecoder.h
 #pragma once
 
-#include <variant>
-
-#include "../../utils/AudioTypes.h" // 包含 AudioFormatInfo 和 IOBufWarp
+#include "../../utils/AudioTypes.h" // 包含 AudioFormatInfo 和 ByteSource
 
 // 定义 AudioDecoder 类
 class AudioDecoder {
@@ -17,8 +15,9 @@ public:
     virtual int getCurrentSamples() = 0;
     virtual int getTotalSamples() = 0;
 
-    virtual void setBuffer(DataVariant* buffer) {
-        data_warpper_ = buffer;
+    // 数据源由调用方持有，需在 setup 之前设置
+    virtual void setSource(ByteSource* source) {
+        source_ = source;
     }
 
     virtual void reset() = 0;
@@ -26,5 +25,5 @@ public:
     virtual AudioFormatInfo getAudioFormat() = 0;
 
 protected:
-    std::variant<BufferWarp, IOBufWarp> *data_warpper_{};
+    ByteSource *source_ = nullptr;
 };
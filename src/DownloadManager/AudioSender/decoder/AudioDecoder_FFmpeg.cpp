@@ -1,8 +1,10 @@
 #include "AudioDecoder_FFmpeg.h"
 #include "CustomIO.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <glog/logging.h> // 包含glog头文件
+#include "../../../ConfigManager.h"
 
 // 获取 FFmpeg 错误字符串的辅助函数
 const char *FfmpegDecoder::get_av_error_string(int errnum) {
@@ -14,8 +16,10 @@ const char *FfmpegDecoder::get_av_error_string(int errnum) {
 // 构造函数
 FfmpegDecoder::FfmpegDecoder()
         : format_ctx_(nullptr), codec_ctx_(nullptr), codec_(nullptr), packet_(nullptr), frame_(nullptr),
-          audio_stream_index_(-1), total_samples_(0), is_initialized_(false), needs_reinit_(false), avio_ctx_(nullptr) {
-    VLOG(1) << "[FfmpegDecoder] Constructor called.";
+          audio_stream_index_(-1), total_samples_(0), is_initialized_(false), needs_reinit_(false), avio_ctx_(nullptr),
+          avio_ctx_buffer_size(std::clamp(ConfigManager::getInstance().getConfig().avio_buffer_size,
+                                          MIN_AVIO_BUFFER_SIZE, MAX_AVIO_BUFFER_SIZE)) {
+    VLOG(1) << "[FfmpegDecoder] Constructor called, avio buffer " << avio_ctx_buffer_size << " bytes.";
 }
 
 // 析构函数
@@ -28,6 +32,11 @@ FfmpegDecoder::~FfmpegDecoder() {
 void FfmpegDecoder::cleanupFFmpeg() {
     VLOG(1) << "[FfmpegDecoder] cleanupFFmpeg() start.";
 
+    closeTrack();
+    for (auto &pooled: codec_pool_) {
+        avcodec_free_context(&pooled.ctx);
+    }
+    codec_pool_.clear();
     if (frame_) {
         av_frame_free(&frame_);
         frame_ = nullptr;
@@ -36,24 +45,104 @@ void FfmpegDecoder::cleanupFFmpeg() {
         av_packet_free(&packet_);
         packet_ = nullptr;
     }
-    if (codec_ctx_) {
-        avcodec_free_context(&codec_ctx_);
-        codec_ctx_ = nullptr;
+
+    VLOG(1) << "[FfmpegDecoder] cleanupFFmpeg() done.";
+}
+
+void FfmpegDecoder::closeTrack() {
+    releaseCodecContext();
+    if (packet_) {
+        av_packet_unref(packet_);
+    }
+    if (frame_) {
+        av_frame_unref(frame_);
     }
     if (format_ctx_) {
         avformat_close_input(&format_ctx_);
         format_ctx_ = nullptr;
     }
     if (avio_ctx_) {
-        // avio_context_free 会连同 buffer 一起释放（若由 avio_alloc_context 分配）
+        // avio_context_free 不会释放 buffer，而且 FFmpeg 可能已经替换过它，需要释放当前的 buffer
+        av_freep(&avio_ctx_->buffer);
         avio_context_free(&avio_ctx_);
         avio_ctx_ = nullptr;
     }
+    audio_stream_index_ = -1;
+    total_samples_ = 0;
+    // 打开失败时 getAudioFormat 返回的声道数必须为 0，不能沿用上一首的格式
+    audio_format_ = AudioFormatInfo{};
 
     is_initialized_ = false;
     needs_reinit_ = false;
+}
 
-    VLOG(1) << "[FfmpegDecoder] cleanupFFmpeg() done.";
+void FfmpegDecoder::releaseCodecContext() {
+    if (!codec_ctx_) {
+        return;
+    }
+    if (codec_pool_.size() >= MAX_POOLED_CODECS) {
+        avcodec_free_context(&codec_pool_.front().ctx);
+        codec_pool_.erase(codec_pool_.begin());
+    }
+    codec_pool_.push_back({std::move(codec_key_), codec_ctx_});
+    codec_ctx_ = nullptr;
+    codec_key_ = {};
+}
+
+int FfmpegDecoder::acquireCodecContext(const AVCodecParameters *codecpar) {
+    CodecKey key{codecpar->codec_id, codecpar->sample_rate, codecpar->ch_layout.nb_channels, {}};
+    if (codecpar->extradata && codecpar->extradata_size > 0) {
+        key.extradata.assign(codecpar->extradata, codecpar->extradata + codecpar->extradata_size);
+    }
+
+    auto it = std::find_if(codec_pool_.begin(), codec_pool_.end(),
+                           [&key](const PooledCodec &pooled) { return pooled.key == key; });
+    if (it != codec_pool_.end()) {
+        codec_ctx_ = it->ctx;
+        codec_pool_.erase(it);
+        // 清掉上一首残留的内部状态即可继续使用
+        avcodec_flush_buffers(codec_ctx_);
+        codec_key_ = std::move(key);
+        VLOG(1) << "[FfmpegDecoder] Reusing codec context for " << avcodec_get_name(codecpar->codec_id);
+        return MPG123_OK;
+    }
+
+    codec_ctx_ = avcodec_alloc_context3(codec_);
+    if (!codec_ctx_) {
+        LOG(ERROR) << "[FfmpegDecoder] avcodec_alloc_context3 failed.";
+        return MPG123_ERR;
+    }
+
+    int ret = avcodec_parameters_to_context(codec_ctx_, codecpar);
+    if (ret < 0) {
+        LOG(ERROR) << "[FfmpegDecoder] avcodec_parameters_to_context failed: " << get_av_error_string(ret);
+        avcodec_free_context(&codec_ctx_);
+        return MPG123_ERR;
+    }
+
+    ret = avcodec_open2(codec_ctx_, codec_, nullptr);
+    if (ret < 0) {
+        LOG(ERROR) << "[FfmpegDecoder] avcodec_open2 failed: " << get_av_error_string(ret);
+        avcodec_free_context(&codec_ctx_);
+        return MPG123_ERR;
+    }
+    codec_key_ = std::move(key);
+    return MPG123_OK;
+}
+
+bool FfmpegDecoder::hasUsableStreamParameters() const {
+    for (unsigned int i = 0; i < format_ctx_->nb_streams; ++i) {
+        const AVCodecParameters *codecpar = format_ctx_->streams[i]->codecpar;
+        if (codecpar->codec_id == AV_CODEC_ID_AAC || codecpar->codec_id == AV_CODEC_ID_AAC_LATM) {
+            // HE-AAC（SBR/PS）隐式信令时头部只给出核心层的采样率和声道数，必须试解码才能拿到真实值
+            return false;
+        }
+        if (codecpar->codec_type == AVMEDIA_TYPE_AUDIO && codecpar->codec_id != AV_CODEC_ID_NONE &&
+            codecpar->sample_rate > 0 && codecpar->ch_layout.nb_channels > 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 // 设置解码器（仅标记，真正初始化延迟到 getAudioFormat() 或 read() 时）
@@ -65,119 +154,110 @@ int FfmpegDecoder::setup() {
 // 修改后的 initialize_decoder() 部分
 int FfmpegDecoder::initialize_decoder() {
     VLOG(1) << "[FfmpegDecoder] initialize_decoder() start.";
-    cleanupFFmpeg();
+    closeTrack();
 
-    // 1. 创建自定义 AVIOContext（保持原有逻辑不变）
-    if (auto buffer_warp = std::get_if<BufferWarp>(data_warpper_)) {
-        auto *avio_ctx_buffer = static_cast<unsigned char *>(av_malloc(avio_ctx_buffer_size));
-        if (!avio_ctx_buffer) {
-            LOG(ERROR) << "[FfmpegDecoder] av_malloc for avio_ctx_buffer failed.";
-            return MPG123_ERR;
-        }
-        avio_ctx_ = avio_alloc_context(
-                avio_ctx_buffer,
-                avio_ctx_buffer_size,
-                0,
-                buffer_warp,
-                CustomIO::custom_read,
-                nullptr,
-                CustomIO::custom_seek
-        );
-        if (!avio_ctx_) {
-            LOG(ERROR) << "[FfmpegDecoder] avio_alloc_context failed.";
-            av_free(avio_ctx_buffer);
-            return MPG123_ERR;
-        }
-    } else if (auto *iobuf_warp = std::get_if<IOBufWarp>(data_warpper_)) {
-        auto *avio_ctx_buffer = static_cast<unsigned char *>(av_malloc(avio_ctx_buffer_size));
-        if (!avio_ctx_buffer) {
-            LOG(ERROR) << "[FfmpegDecoder] av_malloc for avio_ctx_buffer failed.";
-            return MPG123_ERR;
-        }
-        avio_ctx_ = avio_alloc_context(
-                avio_ctx_buffer,
-                avio_ctx_buffer_size,
-                0,
-                iobuf_warp,
-                CustomIO::iobuf_ffmpeg_read,
-                nullptr,
-                CustomIO::iobuf_ffmpeg_seek
-        );
-        if (!avio_ctx_) {
-            LOG(ERROR) << "[FfmpegDecoder] avio_alloc_context failed.";
-            av_free(avio_ctx_buffer);
-            return MPG123_ERR;
-        }
+    // 1. 创建自定义 AVIOContext，直接从 ByteSource 读取
+    if (!source_) {
+        LOG(ERROR) << "[FfmpegDecoder] Source not set.";
+        return MPG123_ERR;
+    }
+    // 数据不足时上一次打开会失败，下载侧唤醒后从头重试
+    source_->seek(0);
+    auto *avio_ctx_buffer = static_cast<unsigned char *>(av_malloc(avio_ctx_buffer_size));
+    if (!avio_ctx_buffer) {
+        LOG(ERROR) << "[FfmpegDecoder] av_malloc for avio_ctx_buffer failed.";
+        return MPG123_ERR;
+    }
+    avio_ctx_ = avio_alloc_context(
+            avio_ctx_buffer,
+            avio_ctx_buffer_size,
+            0,
+            source_,
+            CustomIO::source_read,
+            nullptr,
+            CustomIO::source_seek
+    );
+    if (!avio_ctx_) {
+        LOG(ERROR) << "[FfmpegDecoder] avio_alloc_context failed.";
+        av_free(avio_ctx_buffer);
+        return MPG123_ERR;
+    }
+    if (source_->is_fully_resident()) {
+        // 数据已全部在内存中：avio_read 直接从数据源拷贝到调用方内存，seek 也直接交给数据源，不经过 AVIO 缓冲区中转
+        avio_ctx_->direct = 1;
     }
 
     // 2. 创建 AVFormatContext 并指定自定义 IO
     format_ctx_ = avformat_alloc_context();
     if (!format_ctx_) {
         LOG(ERROR) << "[FfmpegDecoder] avformat_alloc_context failed.";
-        cleanupFFmpeg();
+        closeTrack();
         return MPG123_ERR;
     }
     format_ctx_->pb = avio_ctx_;
 
-    // 3. 打开输入（使用自定义 IO）
-    int ret = avformat_open_input(&format_ctx_, nullptr, nullptr, nullptr);
+    // 3. 打开输入（使用自定义 IO），已知容器格式时跳过探测
+    int ret = avformat_open_input(&format_ctx_, nullptr, input_format_, nullptr);
     if (ret < 0) {
         LOG(ERROR) << "[FfmpegDecoder] avformat_open_input failed: " << get_av_error_string(ret);
-        cleanupFFmpeg();
+        closeTrack();
+        if (ret == AVERROR(EAGAIN)) {
+            // 数据还没下载够，保留探测出的格式，等更多数据后重试
+            return MPG123_NEED_MORE;
+        }
+        if (input_format_) {
+            // 只探测了开头 4 KB 的格式可能不准，退回由 FFmpeg 自行探测
+            input_format_ = nullptr;
+            source_->seek(0);
+            return initialize_decoder();
+        }
         return MPG123_ERR;
     }
 
-    // 4. 检索流信息
-    ret = avformat_find_stream_info(format_ctx_, nullptr);
-    if (ret < 0) {
-        LOG(ERROR) << "[FfmpegDecoder] avformat_find_stream_info failed: " << get_av_error_string(ret);
-        cleanupFFmpeg();
-        return MPG123_ERR;
+    // 4. 检索流信息：find_stream_info 会预读并试解码，容器头已经给出参数时跳过
+    bool stream_info_found = false;
+    if (!hasUsableStreamParameters()) {
+        ret = avformat_find_stream_info(format_ctx_, nullptr);
+        if (ret < 0) {
+            LOG(ERROR) << "[FfmpegDecoder] avformat_find_stream_info failed: " << get_av_error_string(ret);
+            closeTrack();
+            return MPG123_ERR;
+        }
+        stream_info_found = true;
     }
 
     // 5. 查找最佳音频流
     ret = av_find_best_stream(format_ctx_, AVMEDIA_TYPE_AUDIO, -1, -1, &codec_, 0);
+    if (ret < 0 && !stream_info_found && avformat_find_stream_info(format_ctx_, nullptr) >= 0) {
+        ret = av_find_best_stream(format_ctx_, AVMEDIA_TYPE_AUDIO, -1, -1, &codec_, 0);
+    }
     if (ret < 0) {
         LOG(ERROR) << "[FfmpegDecoder] Could not find audio stream: " << get_av_error_string(ret);
-        cleanupFFmpeg();
+        closeTrack();
         return MPG123_ERR;
     }
     audio_stream_index_ = ret;
 
-    // 6. 分配解码器上下文
-    codec_ctx_ = avcodec_alloc_context3(codec_);
-    if (!codec_ctx_) {
-        LOG(ERROR) << "[FfmpegDecoder] avcodec_alloc_context3 failed.";
-        cleanupFFmpeg();
+    // 6. 取得解码器上下文（优先复用池中参数相同的）
+    if (acquireCodecContext(format_ctx_->streams[audio_stream_index_]->codecpar) != MPG123_OK) {
+        closeTrack();
         return MPG123_ERR;
     }
 
-    // 7. 复制流参数到解码器上下文
-    ret = avcodec_parameters_to_context(codec_ctx_, format_ctx_->streams[audio_stream_index_]->codecpar);
-    if (ret < 0) {
-        LOG(ERROR) << "[FfmpegDecoder] avcodec_parameters_to_context failed: " << get_av_error_string(ret);
-        cleanupFFmpeg();
-        return MPG123_ERR;
+    // 7. packet_ 和 frame_ 在曲目之间保留，只在第一次分配
+    if (!packet_) {
+        packet_ = av_packet_alloc();
     }
-
-    // 8. 打开解码器
-    ret = avcodec_open2(codec_ctx_, codec_, nullptr);
-    if (ret < 0) {
-        LOG(ERROR) << "[FfmpegDecoder] avcodec_open2 failed: " << get_av_error_string(ret);
-        cleanupFFmpeg();
-        return MPG123_ERR;
+    if (!frame_) {
+        frame_ = av_frame_alloc();
     }
-
-    // 9. 分配 packet_ 和 frame_
-    packet_ = av_packet_alloc();
-    frame_ = av_frame_alloc();
     if (!packet_ || !frame_) {
         LOG(ERROR) << "[FfmpegDecoder] av_packet_alloc / av_frame_alloc failed.";
-        cleanupFFmpeg();
+        closeTrack();
         return MPG123_ERR;
     }
 
-    // 10. 设置音频格式信息（关键修改：使用 codec_ctx_->channels 优先）
+    // 8. 设置音频格式信息（关键修改：使用 codec_ctx_->channels 优先）
     audio_format_.sample_rate = codec_ctx_->sample_rate;
     // 从 AVCodecParameters 中获取通道数（注意：AVCodecParameters 存在于 format_ctx_->streams[index]->codecpar 中）
     AVCodecParameters *codecpar = format_ctx_->streams[audio_stream_index_]->codecpar;
@@ -196,11 +276,13 @@ int FfmpegDecoder::initialize_decoder() {
                                      ? codec_ctx_->bits_per_raw_sample
                                      : audio_format_.bytes_per_sample * 8;
 
-    // 11. 计算总样本数（若可用）
+    // 9. 计算总样本数（若可用），跳过 find_stream_info 时流上可能没有时长，退回容器时长
     AVStream *audio_stream = format_ctx_->streams[audio_stream_index_];
     if (audio_stream->duration != AV_NOPTS_VALUE && codec_ctx_->sample_rate > 0) {
         double duration_sec = audio_stream->duration * av_q2d(audio_stream->time_base);
         total_samples_ = static_cast<int64_t>(duration_sec * codec_ctx_->sample_rate);
+    } else if (format_ctx_->duration != AV_NOPTS_VALUE && codec_ctx_->sample_rate > 0) {
+        total_samples_ = av_rescale(format_ctx_->duration, codec_ctx_->sample_rate, AV_TIME_BASE);
     } else {
         total_samples_ = 0; // 未知
     }
@@ -262,6 +344,18 @@ int FfmpegDecoder::copyDecodedData(AVFrame *frame,
 }
 
 // 读取解码后的音频数据
+bool FfmpegDecoder::hasReadLookahead() const {
+    if (!source_ || source_->is_complete()) {
+        return true;
+    }
+    size_t needed = PROGRESSIVE_LOOKAHEAD;
+    size_t total_size = source_->total_size();
+    if (total_size != ByteSource::UNKNOWN_SIZE) {
+        needed = std::min(needed, total_size > source_->tell() ? total_size - source_->tell() : 0);
+    }
+    return source_->available() >= needed;
+}
+
 int FfmpegDecoder::read(void *output_buffer, int buffer_size, size_t *data_size) {
     if (!data_size) {
         LOG(ERROR) << "[FfmpegDecoder] read: data_size is null!";
@@ -291,6 +385,13 @@ int FfmpegDecoder::read(void *output_buffer, int buffer_size, size_t *data_size)
 
     // 循环读包并解码，尝试读取多个帧
     while (total_copied < static_cast<size_t>(buffer_size)) {
+        if (!hasReadLookahead()) {
+            // 下载还没跟上，已经解出的数据先交出去
+            if (total_copied > 0) {
+                break;
+            }
+            return MPG123_NEED_MORE;
+        }
         ret = av_read_frame(format_ctx_, packet_);
         if (ret < 0) {
             if (ret == AVERROR_EOF)
@@ -410,6 +511,59 @@ int FfmpegDecoder::read(void *output_buffer, int buffer_size, size_t *data_size)
     return MPG123_OK;
 }
 
+bool FfmpegDecoder::isOpusStream() const {
+    if (!is_initialized_ || audio_stream_index_ < 0) {
+        return false;
+    }
+    const AVCodecParameters *codecpar = format_ctx_->streams[audio_stream_index_]->codecpar;
+    if (codecpar->codec_id != AV_CODEC_ID_OPUS || codecpar->ch_layout.nb_channels > 2) {
+        return false;
+    }
+    // OpusHead 第 18 字节为声道映射族，非 0 表示多流，RTP 单流无法承载
+    return codecpar->extradata_size < 19 || codecpar->extradata[18] == 0;
+}
+
+int64_t FfmpegDecoder::sourceBitRate() const {
+    if (!is_initialized_ || audio_stream_index_ < 0) {
+        return 0;
+    }
+    int64_t bit_rate = format_ctx_->streams[audio_stream_index_]->codecpar->bit_rate;
+    return bit_rate > 0 ? bit_rate : std::max<int64_t>(format_ctx_->bit_rate, 0);
+}
+
+int FfmpegDecoder::readPacket(std::vector<uint8_t> &data) {
+    data.clear();
+    if (!is_initialized_ || needs_reinit_) {
+        if (initialize_decoder() != MPG123_OK) {
+            LOG(ERROR) << "[FfmpegDecoder] readPacket: initialize_decoder failed.";
+            return MPG123_ERR;
+        }
+    }
+
+    while (true) {
+        if (!hasReadLookahead()) {
+            return MPG123_NEED_MORE;
+        }
+        int ret = av_read_frame(format_ctx_, packet_);
+        if (ret == AVERROR(EAGAIN)) {
+            return MPG123_NEED_MORE;
+        }
+        if (ret < 0) {
+            if (ret != AVERROR_EOF) {
+                LOG(ERROR) << "[FfmpegDecoder] readPacket: av_read_frame failed: " << get_av_error_string(ret);
+            }
+            return MPG123_DONE;
+        }
+        if (packet_->stream_index != audio_stream_index_) {
+            av_packet_unref(packet_);
+            continue;
+        }
+        data.assign(packet_->data, packet_->data + packet_->size);
+        av_packet_unref(packet_);
+        return MPG123_OK;
+    }
+}
+
 // 定位到指定时间（秒）
 int FfmpegDecoder::seek(double target_seconds) {
     if (!is_initialized_) {
@@ -483,10 +637,11 @@ int FfmpegDecoder::getTotalSamples() {
     return static_cast<int>(total_samples_);
 }
 
-// 重置解码器
+// 重置解码器：只关闭当前曲目，解码器上下文与 packet/frame 留给下一首复用
 void FfmpegDecoder::reset() {
     VLOG(1) << "[FfmpegDecoder] reset() called.";
-    cleanupFFmpeg();
+    closeTrack();
+    input_format_ = nullptr;
     needs_reinit_ = true;
 }
 
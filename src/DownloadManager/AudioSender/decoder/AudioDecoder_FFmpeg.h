@@ -3,6 +3,7 @@
 #include "AudioDecoder.h"
 #include <memory>
 #include <stdexcept>
+#include <vector>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -30,10 +31,42 @@ public:
 
     AudioFormatInfo getAudioFormat() override;
 
+    // 探测阶段已识别出的容器格式，打开输入时直接使用，跳过 FFmpeg 的二次探测
+    void setInputFormat(const AVInputFormat *format) { input_format_ = format; }
+
+    // 当前曲目是否为可以直通的 Opus 流（单声道或立体声，映射族 0）
+    [[nodiscard]] bool isOpusStream() const;
+
+    // 流或容器给出的码率（bps），未知时返回 0
+    [[nodiscard]] int64_t sourceBitRate() const;
+
+    // 直通模式：读取下一个音频包的原始数据而不解码，返回值与 read 相同
+    int readPacket(std::vector<uint8_t> &data);
+
 private:
+    // 按编解码参数缓存已打开的解码器上下文，同编码的下一首直接 flush 后复用，免去 avcodec_open2
+    struct CodecKey {
+        AVCodecID codec_id = AV_CODEC_ID_NONE;
+        int sample_rate = 0;
+        int channels = 0;
+        std::vector<uint8_t> extradata;
+
+        bool operator==(const CodecKey &) const = default;
+    };
+
+    struct PooledCodec {
+        CodecKey key;
+        AVCodecContext *ctx;
+    };
+
+    static constexpr size_t MAX_POOLED_CODECS = 4;
+
     AVFormatContext *format_ctx_;
     AVCodecContext *codec_ctx_;
+    CodecKey codec_key_;
+    std::vector<PooledCodec> codec_pool_; // 按归还顺序排列，满了淘汰最早的
     const AVCodec *codec_;
+    const AVInputFormat *input_format_ = nullptr;
     AVPacket *packet_;
     AVFrame *frame_;
 
@@ -47,13 +80,31 @@ private:
 
     // 持有 AVIOContext
     AVIOContext *avio_ctx_;
-    static constexpr int avio_ctx_buffer_size = 4096;
+    static constexpr int MIN_AVIO_BUFFER_SIZE = 4 * 1024;
+    static constexpr int MAX_AVIO_BUFFER_SIZE = 1024 * 1024;
+    int avio_ctx_buffer_size; // 来自配置 avio_buffer_size，限制在上面的范围内
+
+    // 边下载边解码时，读包前要求至少有这么多已下载数据（或已到文件末尾），避免 demuxer 读到半个包
+    static constexpr size_t PROGRESSIVE_LOOKAHEAD = 256 * 1024;
+
+    bool hasReadLookahead() const;
 
     // 辅助函数
     int initialize_decoder();
 
     void cleanupFFmpeg();
 
+    // 关闭当前曲目的容器与 AVIO，解码器上下文归还到池中，packet/frame 保留
+    void closeTrack();
+
+    // 从池中取出参数匹配的解码器上下文，没有则新建并打开
+    int acquireCodecContext(const AVCodecParameters *codecpar);
+
+    void releaseCodecContext();
+
+    // 容器头部已经给出完整音频参数时无需 avformat_find_stream_info；含 AAC 流时总是需要
+    bool hasUsableStreamParameters() const;
+
     /**
      * @brief 将解码得到的 AVFrame 数据拷贝到外部缓冲区
      * @param frame 解码出的音频帧
@@ -1,11 +1,13 @@
 // Mpg123Decoder.cpp
 #include "AudioDecoder_Mpg123.h"
-#include "CustomIO.hpp" // 假设你有一个 CustomIO 类处理自定义 IO
 #include <cstring>
-#include <variant>
+#include <vector>
+#include <glog/logging.h>
+#include "../../../ConfigManager.h"
 
 Mpg123Decoder::Mpg123Decoder()
-        : is_initialized_(false), mpg123_handle_(nullptr) {
+        : is_initialized_(false), mpg123_handle_(nullptr),
+          fixed_output_(ConfigManager::getInstance().getConfig().mpg123_fixed_output) {
     int err = MPG123_OK;
     mpg123_handle_ = mpg123_new(nullptr, &err);
     if (!mpg123_handle_) {
@@ -13,15 +15,31 @@ Mpg123Decoder::Mpg123Decoder()
         return;
     }
 
-    // 设置参数
+    // 设置参数（只在构造时配置一次，mpg123_close 之后依然保留，解码器由 DecoderPool 复用）
     int MPGFlag = MPG123_SEEKBUFFER; // 启用内部缓冲区加速 seek。
     // MPGFlag |= MPG123_NO_PEEK_END;
     // MPGFlag |= MPG123_NO_READAHEAD;
     // MPGFlag |= MPG123_FUZZY;
-    mpg123_param2(mpg123_handle_, MPGFlag, 1, 0.0);
+    if (fixed_output_) {
+        MPGFlag |= MPG123_FORCE_STEREO; // 单声道文件也输出双声道
+    }
+    mpg123_param2(mpg123_handle_, MPG123_ADD_FLAGS, MPGFlag, 0.0);
 
     mpg123_format_none(mpg123_handle_);
-    mpg123_format_all(mpg123_handle_);
+    if (fixed_output_) {
+        // 固定输出 48kHz 立体声 S16：非 48kHz 的文件由 mpg123 在解码时用 NtoM 重采样，
+        // 下游的 S16 分支既不用转换也不用 libsamplerate
+        mpg123_param2(mpg123_handle_, MPG123_FORCE_RATE, FIXED_OUTPUT_RATE, 0.0);
+        if (mpg123_format(mpg123_handle_, FIXED_OUTPUT_RATE, MPG123_STEREO, MPG123_ENC_SIGNED_16) != MPG123_OK) {
+            LOG(WARNING) << "mpg123 不支持固定输出格式，回退为原始格式: " << mpg123_strerror(mpg123_handle_);
+            fixed_output_ = false;
+            mpg123_param2(mpg123_handle_, MPG123_FORCE_RATE, 0, 0.0);
+            mpg123_param2(mpg123_handle_, MPG123_REMOVE_FLAGS, MPG123_FORCE_STEREO, 0.0);
+        }
+    }
+    if (!fixed_output_) {
+        mpg123_format_all(mpg123_handle_);
+    }
 }
 
 Mpg123Decoder::~Mpg123Decoder() {
@@ -32,76 +50,100 @@ Mpg123Decoder::~Mpg123Decoder() {
 }
 
 int Mpg123Decoder::setup() {
-    if (!data_warpper_) {
-        LOG(ERROR) << "Buffer not set";
+    if (!source_) {
+        LOG(ERROR) << "Source not set";
         return -1;
     }
 
-    if (iobuf_wrapper) {
-        iobuf_wrapper = nullptr;
-    }
-
     if (is_initialized_) {
         // 重置 mpg123 的内部状态
         mpg123_close(mpg123_handle_);
         is_initialized_ = false;
     }
 
-    if (auto buffer_warp = std::get_if<BufferWarp>(data_warpper_)) {
-        mpg123_replace_reader_handle(mpg123_handle_, CustomIO::custom_mpg123_read, CustomIO::custom_mpg123_lseek,
-                                     nullptr);
-        int ret = mpg123_open_handle(mpg123_handle_, buffer_warp);
-        if (ret != MPG123_OK) {
-            LOG(ERROR) << "mpg123_open_handle failed: " << mpg123_strerror(mpg123_handle_);
-            return -1;
-        }
-    } else if (auto *iobuf_warp = std::get_if<IOBufWarp>(data_warpper_)) {
-        mpg123_replace_reader_handle(mpg123_handle_, CustomIO::iobuf_mpg123_read, CustomIO::iobuf_mpg123_lseek,
-                                     nullptr);
-        // int ret = mpg123_open_handle(mpg123_handle_, buffer_warp);
-        int ret = mpg123_open_feed(mpg123_handle_);
-        iobuf_wrapper = iobuf_warp;
-        if (ret != MPG123_OK) {
-            LOG(ERROR) << "mpg123_open_handle failed: " << mpg123_strerror(mpg123_handle_);
-            return -1;
-        }
+    // 所有数据源都走 feed 模式：按块借出数据直接喂入，不再区分内存缓冲区和 IOBuf 链
+    int ret = mpg123_open_feed(mpg123_handle_);
+    if (ret != MPG123_OK) {
+        LOG(ERROR) << "mpg123_open_feed failed: " << mpg123_strerror(mpg123_handle_);
+        return -1;
     }
+    filesize_set_ = false;
 
     is_initialized_ = true;
 
     return 0;
 }
 
-int Mpg123Decoder::read(void *output_buffer, int buffer_size, size_t *data_size) {
-    if (iobuf_wrapper != nullptr) {
-        auto iobuf = iobuf_wrapper->io_buf_queue->pop_front();
-        if (iobuf != nullptr) {
-            mpg123_feed(mpg123_handle_, iobuf->data(), iobuf->length());
+size_t Mpg123Decoder::feed() {
+    if (!filesize_set_) {
+        size_t total_size = source_->total_size();
+        if (total_size != ByteSource::UNKNOWN_SIZE) {
+            // 总大小已知后 mpg123_length 才能在没有 Xing 头时估算时长
+            mpg123_set_filesize(mpg123_handle_, static_cast<off_t>(total_size));
+            filesize_set_ = true;
         }
     }
+
+    auto span = source_->peek(FEED_CHUNK_SIZE);
+    if (span.empty()) {
+        return 0;
+    }
+    if (mpg123_feed(mpg123_handle_, span.data(), span.size()) != MPG123_OK) {
+        LOG(ERROR) << "mpg123_feed failed: " << mpg123_strerror(mpg123_handle_);
+        return 0;
+    }
+    source_->advance(span.size());
+    return span.size();
+}
+
+int Mpg123Decoder::read(void *output_buffer, int buffer_size, size_t *data_size) {
     int result = mpg123_read(mpg123_handle_, static_cast<unsigned char *>(output_buffer), buffer_size, data_size);
+    while (result == MPG123_NEED_MORE && *data_size == 0) {
+        if (feed() == 0) {
+            // 数据源已读完且不会再增长时才算结束，否则等待下载
+            return source_->is_eof() ? MPG123_DONE : MPG123_NEED_MORE;
+        }
+        result = mpg123_read(mpg123_handle_, static_cast<unsigned char *>(output_buffer), buffer_size, data_size);
+    }
+
+    if (result == MPG123_NEED_MORE) {
+        // 已经解出部分数据，先交给调用方，下次再喂
+        return MPG123_OK;
+    }
 
     if (result == MPG123_ERR) {
         LOG(ERROR) << "MP3 decoding error: " << mpg123_strerror(mpg123_handle_);
         return -1;
     }
 
-    if (result == MPG123_DONE) {
-        // 处理解码结束（根据需要）
-    }
-
     return result;
 }
 
 int Mpg123Decoder::seek(double target_seconds) {
-    off_t frame_offset = mpg123_timeframe(mpg123_handle_, target_seconds);
-    if (frame_offset < 0) {
-        LOG(ERROR) << "mpg123_timeframe error: " << mpg123_strerror(mpg123_handle_);
+    if (audio_format_.sample_rate <= 0) {
+        LOG(ERROR) << "mpg123 seek before format is known";
         return -1;
     }
-    off_t ret = mpg123_seek_frame(mpg123_handle_, frame_offset, SEEK_SET);
+    // mpg123 的样本偏移以输出采样率计，固定输出模式下即重采样后的 48kHz
+    auto sample_offset = static_cast<off_t>(target_seconds * audio_format_.sample_rate);
+    if (frame_index_ && frame_index_->ready()) {
+        // 用下载时扫描出的帧偏移替换 mpg123 的内部索引，VBR 无 TOC 时也能精确定位
+        auto offsets = frame_index_->offsets();
+        std::vector<off_t> index(offsets.begin(), offsets.end());
+        if (!index.empty() &&
+            mpg123_set_index(mpg123_handle_, index.data(), Mp3FrameIndex::FRAMES_PER_ENTRY, index.size()) != MPG123_OK) {
+            LOG(WARNING) << "mpg123_set_index failed: " << mpg123_strerror(mpg123_handle_);
+        }
+    }
+    // feed 模式下由 mpg123 给出需要从哪个输入位置继续喂数据
+    off_t input_offset = 0;
+    off_t ret = mpg123_feedseek(mpg123_handle_, sample_offset, SEEK_SET, &input_offset);
     if (ret < 0) {
-        LOG(ERROR) << "mpg123_seek_frame error: " << mpg123_strerror(mpg123_handle_);
+        LOG(ERROR) << "mpg123_feedseek error: " << mpg123_strerror(mpg123_handle_);
+        return -1;
+    }
+    if (!source_->seek(static_cast<size_t>(input_offset))) {
+        LOG(ERROR) << "Seek out of range. Position: " << input_offset;
         return -1;
     }
     return 0;
@@ -112,6 +154,13 @@ int Mpg123Decoder::getCurrentSamples() {
 }
 
 int Mpg123Decoder::getTotalSamples() {
+    if (frame_index_ && frame_index_->ready() && frame_index_->sample_rate() > 0 && audio_format_.sample_rate > 0) {
+        // 帧索引按源采样率计数，换算到输出采样率；下载未完成时为按比例的估算值
+        uint64_t samples = frame_index_->total_samples() * audio_format_.sample_rate / frame_index_->sample_rate();
+        if (samples > 0) {
+            return static_cast<int>(samples);
+        }
+    }
     return static_cast<int>(mpg123_length(mpg123_handle_));
 }
 
@@ -122,6 +171,7 @@ void Mpg123Decoder::reset() {
     if (mpg123_handle_) {
         mpg123_close(mpg123_handle_);
     }
+    frame_index_ = nullptr;
     is_initialized_ = false;
 }
 
@@ -139,16 +189,18 @@ int get_bit_depth_from_encoding(int encoding) {
 }
 
 AudioFormatInfo Mpg123Decoder::getAudioFormat() {
-    if (iobuf_wrapper != nullptr) {
-        auto iobuf = iobuf_wrapper->io_buf_queue->pop_front();
-        if (iobuf != nullptr) {
-            mpg123_feed(mpg123_handle_, iobuf->data(), iobuf->length());
-        }
-    }
     long rate = 0;
     int encoding = 0;
     int channels = 0;
-    if (mpg123_getformat(mpg123_handle_, &rate, &channels, &encoding) != MPG123_OK) {
+    // feed 模式下解析到第一帧之前返回 MPG123_NEED_MORE，持续喂入直到拿到格式或暂时没有数据
+    int ret = mpg123_getformat(mpg123_handle_, &rate, &channels, &encoding);
+    while (ret == MPG123_NEED_MORE && feed() > 0) {
+        ret = mpg123_getformat(mpg123_handle_, &rate, &channels, &encoding);
+    }
+    if (ret == MPG123_NEED_MORE) {
+        // 还没解析到第一帧，调用方等到更多数据后重试
+        VLOG(1) << "mpg123_getformat: need more data";
+    } else if (ret != MPG123_OK) {
         LOG(ERROR) << "mpg123_getformat failed: " << mpg123_strerror(mpg123_handle_);
     }
     audio_format_.sample_rate = static_cast<int>(rate);
@@ -2,6 +2,7 @@
 #pragma once
 
 #include "AudioDecoder.h"
+#include "../../utils/Mp3FrameIndex.h"
 #include <mpg123.h>
 
 // 定义 Mpg123Decoder 类
@@ -27,9 +28,19 @@ public:
 
     AudioFormatInfo getAudioFormat() override;
 
+    // 下载时建立的帧索引，用于精确 seek 和下载完成前的总时长；reset 时解除
+    void setFrameIndex(const Mp3FrameIndex *index) { frame_index_ = index; }
+
 private:
+    static constexpr size_t FEED_CHUNK_SIZE = 64 * 1024; // 每次喂给 mpg123 的最大字节数
+    static constexpr long FIXED_OUTPUT_RATE = 48000;    // 与 Opus 编码采样率一致
+
     mpg123_handle *mpg123_handle_;
+    bool fixed_output_; // 构造时按配置决定，之后不再变化
     AudioFormatInfo audio_format_;
+    bool filesize_set_ = false;
+    const Mp3FrameIndex *frame_index_ = nullptr;
 
-    IOBufWarp *iobuf_wrapper = nullptr;
+    // 把数据源中已就绪的一段借出的数据喂给 mpg123，返回喂入的字节数
+    size_t feed();
 };
@@ -0,0 +1,56 @@
+#include "DecoderPool.h"
+#include "AudioDecoder_Mpg123.h"
+#include "AudioDecoder_FFmpeg.h"
+
+#include <glog/logging.h>
+
+DecoderPool &DecoderPool::getInstance() {
+    static DecoderPool instance;
+    return instance;
+}
+
+DecoderPool::Lease DecoderPool::acquire(Kind kind) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &idle = idleList(kind);
+        if (!idle.empty()) {
+            AudioDecoder *decoder = idle.back().release();
+            idle.pop_back();
+            return Lease(decoder, Returner{kind});
+        }
+    }
+
+    // 在锁外创建，mpg123_new 与参数配置只在这里发生一次
+    VLOG(1) << "[DecoderPool] 新建解码器，类型 " << static_cast<int>(kind);
+    std::unique_ptr<AudioDecoder> decoder;
+    if (kind == Kind::Mpg123) {
+        decoder = std::make_unique<Mpg123Decoder>();
+    } else {
+        decoder = std::make_unique<FfmpegDecoder>();
+    }
+    return Lease(decoder.release(), Returner{kind});
+}
+
+size_t DecoderPool::idleCount(Kind kind) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idleList(kind).size();
+}
+
+void DecoderPool::release(Kind kind, AudioDecoder *decoder) {
+    std::unique_ptr<AudioDecoder> owned(decoder);
+    // 清理曲目状态后再放回，下一个租用者拿到的是干净的实例
+    owned->reset();
+    owned->setSource(nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto &idle = idleList(kind);
+    if (idle.size() < MAX_IDLE_PER_KIND) {
+        idle.push_back(std::move(owned));
+    }
+}
+
+void DecoderPool::Returner::operator()(AudioDecoder *decoder) const {
+    if (decoder) {
+        DecoderPool::getInstance().release(kind, decoder);
+    }
+}
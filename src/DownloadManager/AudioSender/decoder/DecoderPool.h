@@ -0,0 +1,57 @@
+// DecoderPool.h
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "AudioDecoder.h"
+
+/**
+ * @brief 进程级解码器池
+ *        解码器在创建时完成一次性配置（mpg123 参数与输出格式等），之后在各个流之间复用。
+ *        AudioSender 只在某个格式的曲目播放期间租用对应的解码器，租约析构时 reset 并归还，
+ *        不播放该格式的流不再常驻一个解码器实例。
+ */
+class DecoderPool {
+public:
+    enum class Kind {
+        Mpg123,
+        FFmpeg,
+    };
+
+    // 租约析构时把解码器归还给池
+    struct Returner {
+        Kind kind = Kind::Mpg123;
+
+        void operator()(AudioDecoder *decoder) const;
+    };
+
+    using Lease = std::unique_ptr<AudioDecoder, Returner>;
+
+    static constexpr size_t MAX_IDLE_PER_KIND = 8; // 每种解码器最多保留的空闲实例
+
+    static DecoderPool &getInstance();
+
+    // 租用一个解码器，池中没有空闲实例时新建
+    Lease acquire(Kind kind);
+
+    // 当前空闲实例数
+    size_t idleCount(Kind kind);
+
+    DecoderPool(const DecoderPool &) = delete;
+
+    DecoderPool &operator=(const DecoderPool &) = delete;
+
+private:
+    DecoderPool() = default;
+
+    void release(Kind kind, AudioDecoder *decoder);
+
+    std::vector<std::unique_ptr<AudioDecoder>> &idleList(Kind kind) {
+        return kind == Kind::Mpg123 ? idle_mpg123_ : idle_ffmpeg_;
+    }
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<AudioDecoder>> idle_mpg123_;
+    std::vector<std::unique_ptr<AudioDecoder>> idle_ffmpeg_;
+};
@@ -1,6 +1,7 @@
 #include <cstdint>
 #include "CustomIO.hpp"
-#include "../../utils/AudioTypes.h"
+#include "../../utils/ByteSource.h"
+#include <glog/logging.h>
 
 extern "C" {
 #include <libavformat/avformat.h>
@@ -8,45 +9,59 @@ extern "C" {
 }
 
 // FFmpeg 自定义读函数
-int CustomIO::custom_read(void *opaque, uint8_t *buf, int buf_size) {
-    auto *adb = static_cast<BufferWarp *>(opaque);
-    size_t available = adb->size() - adb->pos_;
-    int to_read = FFMIN(buf_size, static_cast<int>(available));
-
-    if (to_read <= 0)
-        return AVERROR_EOF;
+int CustomIO::source_read(void *opaque, uint8_t *buf, int buf_size) {
+    auto *source = static_cast<ByteSource *>(opaque);
+    if (!source || buf_size <= 0) {
+        return AVERROR(EINVAL);
+    }
 
-    memcpy(buf, adb->buffer->data() + adb->pos_, to_read);
-    adb->pos_ += to_read;
+    size_t read = source->read_into(buf, static_cast<size_t>(buf_size));
+    if (read == 0) {
+        if (source->is_eof()) {
+            return AVERROR_EOF;
+        }
+        // 数据还在下载，提示解码器稍后重试
+        return AVERROR(EAGAIN);
+    }
 
-    return to_read;
+    VLOG(2) << "Read " << read << " bytes, position: " << source->tell();
+    return static_cast<int>(read);
 }
 
 // FFmpeg 自定义寻址函数
-int64_t CustomIO::custom_seek(void *opaque, int64_t offset, int whence) {
-    auto *adb = static_cast<BufferWarp *>(opaque);
+int64_t CustomIO::source_seek(void *opaque, int64_t offset, int whence) {
+    auto *source = static_cast<ByteSource *>(opaque);
+    if (!source) {
+        return AVERROR(EINVAL);
+    }
+
+    size_t total_size = source->total_size();
+    bool size_known = total_size != ByteSource::UNKNOWN_SIZE;
     int64_t new_pos = 0;
 
-    switch (whence) {
+    switch (whence & ~AVSEEK_FORCE) {
         case SEEK_SET:
             new_pos = offset;
             break;
         case SEEK_CUR:
-            new_pos = static_cast<int64_t>(adb->pos_) + offset;
+            new_pos = static_cast<int64_t>(source->tell()) + offset;
             break;
         case SEEK_END:
-            new_pos = static_cast<int64_t>(adb->size()) + offset;
+            if (!size_known) {
+                return AVERROR(ESPIPE);
+            }
+            new_pos = static_cast<int64_t>(total_size) + offset;
             break;
         case AVSEEK_SIZE:
-            return static_cast<int64_t>(adb->size());
+            // 总大小未知（仍在下载的流）时返回负值，FFmpeg 会按不可定位处理
+            return size_known ? static_cast<int64_t>(total_size) : AVERROR(ENOSYS);
         default:
             return AVERROR(EINVAL);
     }
 
-    if (new_pos < 0 || new_pos > static_cast<int64_t>(adb->size())) {
+    if (new_pos < 0 || !source->seek(static_cast<size_t>(new_pos))) {
+        VLOG(1) << "Seek out of range. Position: " << new_pos;
         return AVERROR(EINVAL);
     }
-
-    adb->pos_ = static_cast<size_t>(new_pos);
     return new_pos;
 }
@@ -76,6 +76,7 @@ coro::task<void> DownloadManager::startQueueJob() {
 
         // extendedTask 存在类中，并且是用一次创建一次，作为 share_ptr 供别处获取，不需要重置它里边的任何状态，没有人用它的时候自然消失
         extendedTask = std::make_shared<ExtendedTaskItem>(std::move(task_item), curl_handle);
+        extendedTask->metrics = &audio_sender_->metrics();
         ExtendedTaskItem *current_task = extendedTask.get();
 
         std::optional<std::string> final_url;
@@ -96,6 +97,7 @@ coro::task<void> DownloadManager::startQueueJob() {
             final_url = extendedTask->item.url;
         }
         curl_easy_setopt(curl_handle.get(), CURLOPT_URL, final_url->c_str());
+        extendedTask->effective_url = *final_url;
 
         // 设置写回调函数
         curl_easy_setopt(curl_handle.get(), CURLOPT_WRITEFUNCTION, write_callback);
@@ -184,15 +186,20 @@ DownloadManager::getRealUrl(const std::string &cached_url, std::shared_ptr<CURL>
         co_return std::nullopt;
     }
 
-    if (res.cookie) {
-        curl_easy_setopt(curl, CURLOPT_COOKIE, res.cookie.value().c_str());
-    }
-    if (res.referer) {
-        curl_easy_setopt(curl, CURLOPT_REFERER, res.referer.value().c_str());
-    }
-    if (res.user_agent) {
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, res.user_agent.value().c_str());
-    }
+    auto apply_options = [res](CURL *handle) {
+        if (res.cookie) {
+            curl_easy_setopt(handle, CURLOPT_COOKIE, res.cookie.value().c_str());
+        }
+        if (res.referer) {
+            curl_easy_setopt(handle, CURLOPT_REFERER, res.referer.value().c_str());
+        }
+        if (res.user_agent) {
+            curl_easy_setopt(handle, CURLOPT_USERAGENT, res.user_agent.value().c_str());
+        }
+    };
+    apply_options(curl);
+    // 同一任务后续的 Range 请求（例如取回 MP4 尾部的 moov）沿用这些选项
+    extendedTask->request_options = apply_options;
 
     co_return res.url;
 }
@@ -220,6 +227,8 @@ coro::task<bool> DownloadManager::executeDownload(ExtendedTaskItem *current_task
                             LOG(ERROR) << "下载失败: " << current_task->item.name << "，错误码: " << result << "，消息: "
                                        << message;
                             current_task->should_skip = true;
+                            current_task->chunks.close();
+                            current_task->close_received();
                             EventCurlFinished.set();
                             return;
                         }
@@ -233,6 +242,8 @@ coro::task<bool> DownloadManager::executeDownload(ExtendedTaskItem *current_task
                                        << "，消息: "
                                        << message;
                             current_task->should_skip = true;
+                            current_task->chunks.close();
+                            current_task->close_received();
                             EventCurlFinished.set();
                             return;
                         }
@@ -243,7 +254,10 @@ coro::task<bool> DownloadManager::executeDownload(ExtendedTaskItem *current_task
                         curl_easy_getinfo(curl_handle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &content_length);
                         current_task->total_size = static_cast<size_t>(content_length);
                         current_task->state = AudioCurrentState::DownloadAndWriteFinished;
-
+                        // 仍在 curl 线程上，发布暂存区剩余数据
+                        current_task->chunks.finish();
+                        current_task->mp3_index.finish();
+                        current_task->close_received();
 
                         EventCurlFinished.set();
                     });
@@ -283,46 +297,34 @@ size_t DownloadManager::write_callback(void *ptr, size_t size, size_t nmemb, voi
     auto *current_task = static_cast<ExtendedTaskItem *>(userdata);
     size_t total_size = size * nmemb;
 
+    if (current_task->total_size == 0) {
+        // 第一次回调时响应头已经收到，记下 Content-Length 供帧索引估算总时长
+        curl_off_t content_length = -1;
+        curl_easy_getinfo(current_task->curl_handler.get(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+        if (content_length > 0) {
+            current_task->expected_size = static_cast<size_t>(content_length);
+            current_task->mp3_index.set_expected_size(static_cast<size_t>(content_length));
+        }
+    }
+
     auto &data = current_task->data;
     if (auto fixed_buffer = std::get_if<FixedCapacityBuffer>(&data)) {
         fixed_buffer->insert(static_cast<const unsigned char *>(ptr), total_size);
-    } else if (auto iobuf = std::get_if<folly::IOBufQueue>(&data)) {
-        std::unique_ptr<folly::IOBuf> data_chunk = folly::IOBuf::copyBuffer(static_cast<const char *>(ptr), total_size);
-        /*{
-            // 加锁追加数据
-            coro::sync_wait(current_task->mutex_data.lock());
-            iobuf->append(std::move(data_chunk));
-        }*/
-        current_task->iobuf_write_queue.append(std::move(data_chunk));
-
-        // 可以防止频繁 append 多线程读写的冲突，并且能减少 IOBUF 的碎片化，充分利用 CPU 缓存。
-        if (current_task->iobuf_write_queue.chainLength() > 1024 * 32) {
-            // 移动当前队列数据到一个连续 IOBuf
-            auto flattened = current_task->iobuf_write_queue.move();
-            flattened->coalesce();  // 合并碎片化数据
-
-            // 当读取上的 iobufqueue 超过某个大小时不再往里边写入，flattened 的内存块会自己释放。
-            if (iobuf->chainLength() > 5 * 1024 * 1024) {
-                current_task->total_size += total_size;
-                curl_easy_pause(current_task->curl_handler.get(), CURLPAUSE_RECV);
-                return total_size;
-            }
-
-            {
-                // 加锁追加数据
-                coro::sync_wait(current_task->mutex_data.lock());
-                iobuf->append(std::move(flattened));
-
-                // 实现固定长度：如果链表超过阈值，移除最早的块
-                // 在下载侧删除数据是坏注意
-                /*while (iobuf->chainLength() > 5 * 1024 * 1024) {
-                    iobuf->pop_front();
-                }*/
-            }
+    } else if (std::holds_alternative<folly::IOBufQueue>(data)) {
+        // 无锁发布给消费侧；缓冲超过上限时暂停接收，curl 恢复后会重新投递这段数据，不会丢失
+        if (!current_task->chunks.append(ptr, total_size)) {
+            return CURL_WRITEFUNC_PAUSE;
         }
     }
 
+    // 只扫描帧头，跳过帧体，开销很小
+    current_task->mp3_index.scan(static_cast<const uint8_t *>(ptr), total_size);
+
     // 累加下载的数据
     current_task->total_size += total_size;
+    if (current_task->metrics) {
+        current_task->metrics->add(StreamMetrics::DownloadedBytes, total_size);
+    }
+    current_task->publish_received(total_size);
     return total_size;
 }
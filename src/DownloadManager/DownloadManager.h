@@ -17,7 +17,7 @@ class AudioSender; // 前向声明
 constexpr int MAX_CHUNK_SIZE = 1024 * 128; // 128 kb
 
 // 定义 DownloadManager 类
-class DownloadManager : public TaskManager, public TaskHandler {
+class DownloadManager : public TaskManager, public TaskHandler, public std::enable_shared_from_this<DownloadManager> {
 public:
     explicit DownloadManager(std::shared_ptr<coro::thread_pool> tp, std::shared_ptr<AudioSender> audio_sender_ptr);
 
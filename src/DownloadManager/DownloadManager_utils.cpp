@@ -12,12 +12,15 @@ bool DownloadManager::skipDownload() {
 }
 
 coro::task<void> DownloadManager::initAndWaitJobs() {
+    // 任务运行期间自己持有一份引用，注册表移除后由最后一个持有者释放
+    auto self = shared_from_this();
     // 调度并等待 startQueueJob 完成
     task_container_.start(startQueueJob());
     const auto ptr = &extendedTask;
     task_container_.start(
             audio_sender_->start_producer(ptr, isStopped));
     task_container_.start(audio_sender_->start_consumer(isStopped));
+    task_container_.start(audio_sender_->start_encoder(isStopped));
     auto sender = audio_sender_->start_sender(isStopped);
     task_container_.start(std::move(sender));
 
@@ -28,7 +31,6 @@ coro::task<void> DownloadManager::initAndWaitJobs() {
     if (removeCallback_) {
         removeCallback_(id_);
     }
-    delete this;
     co_return;
 }
 
@@ -1,19 +1,25 @@
 #include "TaskManager.h"
-#include "../api/EventPublisher.h"
+#include "../api/StatusAggregator.h"
 #include <algorithm>
+#include <cstdlib>
 #include <unordered_set>
 #include <iostream>
 
 TaskManager::TaskManager(ConsumerMode mode)
         : mode(mode),
-          currentIndex(0),
-          rng(std::random_device{}()) {
+          currentIndex(0) {
 }
 
 void TaskManager::setMode(ConsumerMode newMode) {
     std::lock_guard<std::mutex> lock(mtx);
     if (mode != newMode) {
         mode = newMode;
+        if (mode == ConsumerMode::Random) {
+            // 当前任务作为洗牌历史的起点，“上一首”可以回到这里
+            if (auto current = currentName()) {
+                shuffle.visit(*current);
+            }
+        }
         // 是否重置 currentIndex 看需求
         // currentIndex = 0;
         TaskUpdateEvent.set();
@@ -33,10 +39,140 @@ bool TaskManager::addTask(const TaskItem &task_item) {
         return false; // 已有重名任务
     }
     taskOrder.push_back(task_item.name);
+    shuffle.add(task_item.name);
     TaskUpdateEvent.set();
     return true;
 }
 
+bool TaskManager::insertTasksAt(size_t position, const std::vector<TaskItem> &tasks) {
+    std::unordered_set<std::string> names;
+    names.reserve(tasks.size());
+    for (const auto &task: tasks) {
+        if (taskMap.count(task.name) != 0 || !names.insert(task.name).second) {
+            return false;
+        }
+    }
+    auto current = currentName();
+    for (const auto &task: tasks) {
+        taskMap.emplace(task.name, task);
+        taskOrder.insert(position++, task.name);
+        shuffle.add(task.name);
+    }
+    restoreCurrent(current);
+    return true;
+}
+
+bool TaskManager::appendTasks(const std::vector<TaskItem> &tasks) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!insertTasksAt(taskOrder.size(), tasks)) {
+        return false;
+    }
+    notifyOrderChanged();
+    return true;
+}
+
+bool TaskManager::insertTasksAfter(const std::string &anchor, const std::vector<TaskItem> &tasks) {
+    std::lock_guard<std::mutex> lock(mtx);
+    size_t position = 0;
+    if (!anchor.empty()) {
+        auto anchor_index = taskOrder.index_of(anchor);
+        if (!anchor_index) {
+            return false;
+        }
+        position = *anchor_index + 1;
+    }
+    if (!insertTasksAt(position, tasks)) {
+        return false;
+    }
+    notifyOrderChanged();
+    return true;
+}
+
+bool TaskManager::moveTaskAfter(const std::string &taskName, const std::string &anchor) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!taskOrder.contains(taskName) || taskName == anchor) {
+        return false;
+    }
+    auto current = currentName();
+    size_t position = 0;
+    if (!anchor.empty()) {
+        auto anchor_index = taskOrder.index_of(anchor);
+        if (!anchor_index) {
+            return false;
+        }
+        // move 的目标位置以移除自身后的序列计
+        position = *anchor_index + 1;
+        if (*taskOrder.index_of(taskName) < *anchor_index) {
+            position--;
+        }
+    }
+    taskOrder.move(taskName, position);
+    restoreCurrent(current);
+    notifyOrderChanged();
+    return true;
+}
+
+void TaskManager::setShuffleSeed(uint64_t seed) {
+    std::lock_guard<std::mutex> lock(mtx);
+    shuffle.reseed(seed);
+}
+
+uint64_t TaskManager::getShuffleSeed() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return shuffle.seed();
+}
+
+ShuffleOrder::State TaskManager::getShuffleState() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return shuffle.state();
+}
+
+void TaskManager::restoreShuffleState(const ShuffleOrder::State &state) {
+    std::lock_guard<std::mutex> lock(mtx);
+    shuffle.restore(state);
+}
+
+bool TaskManager::shuffleStep(int steps) {
+    auto alive = [this](const std::string &name) { return taskMap.count(name) != 0; };
+    std::optional<std::string> target;
+    for (int i = 0; i < std::abs(steps); ++i) {
+        auto step = steps > 0 ? shuffle.next(alive) : shuffle.previous(alive);
+        if (!step) {
+            break;
+        }
+        target = std::move(step);
+    }
+    if (!target) {
+        return false;
+    }
+    currentIndex = *taskOrder.index_of(*target);
+    return true;
+}
+
+std::optional<std::string> TaskManager::currentName() const {
+    if (currentIndex >= taskOrder.size()) {
+        return std::nullopt;
+    }
+    return taskOrder.at(currentIndex);
+}
+
+void TaskManager::restoreCurrent(const std::optional<std::string> &current) {
+    if (current) {
+        if (auto index = taskOrder.index_of(*current)) {
+            currentIndex = *index;
+            return;
+        }
+    }
+    if (currentIndex >= taskOrder.size()) {
+        currentIndex = 0;
+    }
+}
+
+void TaskManager::notifyOrderChanged() {
+    TaskUpdateEvent.set();
+    StatusAggregator::getInstance().mark_playlist_dirty(stream_id_);
+}
+
 // 移除任务
 bool TaskManager::removeTask(const std::string &taskName) {
     std::lock_guard<std::mutex> lock(mtx);
@@ -44,25 +180,26 @@ bool TaskManager::removeTask(const std::string &taskName) {
     if (it == taskMap.end()) {
         return false;
     }
-    taskOrder.erase(std::remove(taskOrder.begin(), taskOrder.end(), taskName),
-                    taskOrder.end());
+    auto current = currentName();
+    taskOrder.erase(taskName);
     taskMap.erase(it);
 
-    if (currentIndex >= taskOrder.size()) {
-        currentIndex = 0;
-    }
-    TaskUpdateEvent.set();
+    restoreCurrent(current);
+    notifyOrderChanged();
     return true;
 }
 
 // 绝对跳转到指定任务
 bool TaskManager::skipTo(const std::string &taskName) {
     std::lock_guard<std::mutex> lock(mtx);
-    auto it = std::find(taskOrder.begin(), taskOrder.end(), taskName);
-    if (it == taskOrder.end()) {
+    auto index = taskOrder.index_of(taskName);
+    if (!index) {
         return false; // 不存在
     }
-    currentIndex = static_cast<size_t>(std::distance(taskOrder.begin(), it));
+    currentIndex = *index;
+    if (mode == ConsumerMode::Random) {
+        shuffle.visit(taskName);
+    }
     TaskUpdateEvent.set();
     hasManualSkip = true;
     return true;
@@ -75,6 +212,16 @@ bool TaskManager::skipRelative(int offset) {
         return false;
     }
 
+    if (mode == ConsumerMode::Random) {
+        // 随机模式下的相对跳转沿洗牌顺序进行
+        if (!shuffleStep(offset)) {
+            return false;
+        }
+        TaskUpdateEvent.set();
+        hasManualSkip = true;
+        return true;
+    }
+
     int newIndex = static_cast<int>(currentIndex) + offset;
 
     if (mode == ConsumerMode::RoundRobin) {
@@ -129,8 +276,7 @@ void TaskManager::autoNext() {
             break;
         }
         case ConsumerMode::Random: {
-            size_t r = getRandomIndex();
-            currentIndex = r;
+            shuffleStep(1);
             break;
         }
         case ConsumerMode::SingleLoop: {
@@ -146,6 +292,7 @@ void TaskManager::clearTasks() {
     std::lock_guard<std::mutex> lock(mtx);
     taskMap.clear();
     taskOrder.clear();
+    shuffle.rebuild({});
     currentIndex = 0;
     TaskUpdateEvent.set();
 }
@@ -181,23 +328,33 @@ bool TaskManager::updateTasks(const std::vector<TaskItem> &newTasks,
     }
 
     // 更新顺序
-    taskOrder = newOrder;
+    taskOrder.assign(newOrder);
+    shuffle.rebuild(newOrder);
     if (currentIndex >= taskOrder.size()) {
         currentIndex = 0;
     }
 
-    TaskUpdateEvent.set();
-    EventPublisher::getInstance().handle_event_publish(stream_id_, true);
+    notifyOrderChanged();
     return true;
 }
 
+std::vector<TaskItem> TaskManager::getTasksInOrder() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<TaskItem> tasks;
+    tasks.reserve(taskOrder.size());
+    for (const auto &name: taskOrder.to_vector()) {
+        tasks.push_back(taskMap.at(name));
+    }
+    return tasks;
+}
+
 // **不移动索引**，只返回当前索引指向的任务
 std::optional<TaskItem> TaskManager::getNextTask() const {
     std::lock_guard<std::mutex> lock(mtx);
     if (taskOrder.empty() || currentIndex >= taskOrder.size()) {
         return std::nullopt;
     }
-    return taskMap.at(taskOrder[currentIndex]);
+    return taskMap.at(taskOrder.at(currentIndex));
 }
 
 // 查找
@@ -209,11 +366,3 @@ std::optional<TaskItem> TaskManager::findTask(const std::string &taskName) const
     }
     return std::nullopt;
 }
-
-// 随机索引
-size_t TaskManager::getRandomIndex() const {
-    std::lock_guard<std::mutex> lock(rngMutex);
-    if (taskOrder.empty()) return 0;
-    std::uniform_int_distribution<size_t> dist(0, taskOrder.size() - 1);
-    return dist(rng);
-}
@@ -7,6 +7,8 @@
 #include <random>
 #include <mutex>
 #include "coro/event.hpp"
+#include "utils/OrderTree.h"
+#include "utils/ShuffleOrder.h"
 
 enum class TaskType {
     File,
@@ -42,6 +44,23 @@ public:
 
     bool removeTask(const std::string &taskName);
 
+    // 增量修改播放列表，均为 O(log n)（每个任务）；anchor 为空表示最前面
+    bool appendTasks(const std::vector<TaskItem> &tasks);
+
+    bool insertTasksAfter(const std::string &anchor, const std::vector<TaskItem> &tasks);
+
+    bool moveTaskAfter(const std::string &taskName, const std::string &anchor);
+
+    // 随机模式使用的种子，重新设置后从新的排列开始；读出的种子可用于保存与恢复随机顺序
+    void setShuffleSeed(uint64_t seed);
+
+    uint64_t getShuffleSeed() const;
+
+    // 随机模式的完整进度，用于快照；恢复需在 updateTasks 之后调用
+    ShuffleOrder::State getShuffleState() const;
+
+    void restoreShuffleState(const ShuffleOrder::State &state);
+
     // 跳转到指定任务 / 相对跳转
     bool skipTo(const std::string &taskName);
 
@@ -49,7 +68,7 @@ public:
 
     // 给“自动下一首”或“自动上一首”用的，根据 mode 来移动
     // 例如 FIFO => currentIndex++， LIFO => currentIndex--
-    // RoundRobin => (currentIndex+1)%size, Random => 随机选, SingleLoop => 不动
+    // RoundRobin => (currentIndex+1)%size, Random => 按洗牌顺序取下一首（一轮内不重复）, SingleLoop => 不动
     void autoNext();
 
     // 清空
@@ -68,23 +87,42 @@ public:
     // 事件
     coro::event TaskUpdateEvent;
 
-    const std::vector<std::string> &getTaskOrder() const {
-        return taskOrder;
+    std::vector<std::string> getTaskOrder() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return taskOrder.to_vector();
+    }
+
+    // 按播放顺序返回所有任务，用于保存快照
+    std::vector<TaskItem> getTasksInOrder() const;
+
+    size_t getTaskCount() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return taskOrder.size();
     }
 
     bool hasManualSkip = false;
 
 private:
     ConsumerMode mode;
-    std::vector<std::string> taskOrder;
+    OrderTree taskOrder;
     std::unordered_map<std::string, TaskItem> taskMap;
 
     size_t currentIndex;
 
-    mutable std::mt19937 rng;
-    mutable std::mutex rngMutex;
+    ShuffleOrder shuffle; // 随机模式的播放顺序，与其他成员一样由 mtx 保护
     mutable std::mutex mtx;
 
-    // 生成随机索引
-    size_t getRandomIndex() const;
+    // 随机模式下按洗牌顺序前进 / 后退 steps 首，返回 false 表示没有可切换的任务
+    bool shuffleStep(int steps);
+
+    // 修改顺序前记下当前任务，修改后据此恢复 currentIndex，当前任务被移除时保持原位置
+    std::optional<std::string> currentName() const;
+
+    void restoreCurrent(const std::optional<std::string> &current);
+
+    // 在 position 处依次插入任务，有重名时整体失败
+    bool insertTasksAt(size_t position, const std::vector<TaskItem> &tasks);
+
+    // 顺序变化后通知生产者与状态聚合器
+    void notifyOrderChanged();
 };
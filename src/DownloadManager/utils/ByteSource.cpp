@@ -0,0 +1,470 @@
+#include "ByteSource.h"
+#include "../../CurlMultiManager.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glog/logging.h>
+
+// ---------------- ByteSource ----------------
+
+size_t ByteSource::read_into(void *buffer, size_t size) {
+    auto *out = static_cast<uint8_t *>(buffer);
+    size_t copied = 0;
+    while (copied < size) {
+        auto span = peek(size - copied);
+        if (span.empty()) {
+            break;
+        }
+        std::memcpy(out + copied, span.data(), span.size());
+        copied += span.size();
+        advance(span.size());
+    }
+    return copied;
+}
+
+bool ByteSource::is_eof() const {
+    return is_complete() && available() == 0;
+}
+
+// ---------------- MemorySource ----------------
+
+std::span<const uint8_t> MemorySource::peek(size_t max_bytes) {
+    size_t size = current_size();
+    if (pos_ >= size) {
+        return {};
+    }
+    return {base() + pos_, std::min(max_bytes, size - pos_)};
+}
+
+bool MemorySource::seek(size_t pos) {
+    if (pos > current_size()) {
+        return false;
+    }
+    pos_ = pos;
+    return true;
+}
+
+size_t MemorySource::available() const {
+    size_t size = current_size();
+    return size > pos_ ? size - pos_ : 0;
+}
+
+size_t MemorySource::total_size() const {
+    return is_complete() ? current_size() : UNKNOWN_SIZE;
+}
+
+// ---------------- MmapFileSource ----------------
+
+MmapFileSource::MmapFileSource(const std::string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG(ERROR) << "[MmapFileSource] 无法打开文件: " << path;
+        return;
+    }
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        LOG(ERROR) << "[MmapFileSource] 无法获取文件大小或文件为空: " << path;
+        ::close(fd);
+        return;
+    }
+
+    void *mapping = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // 映射建立后即可关闭描述符
+    if (mapping == MAP_FAILED) {
+        LOG(ERROR) << "[MmapFileSource] mmap 失败: " << path;
+        return;
+    }
+    // 解码是顺序读取，提示内核预读
+    ::madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    mapping_ = mapping;
+    mapping_size_ = static_cast<size_t>(st.st_size);
+    reset_view(static_cast<const uint8_t *>(mapping_), mapping_size_);
+    mark_complete();
+}
+
+MmapFileSource::~MmapFileSource() {
+    if (mapping_) {
+        ::munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+}
+
+// ---------------- ChainSource ----------------
+
+void ChainSource::refresh_index() const {
+    const folly::IOBuf *front = queue_ ? queue_->front() : nullptr;
+    if (!front) {
+        index_.clear();
+        length_ = base_;
+        cursor_valid_ = false;
+        return;
+    }
+    if (index_.empty() || index_.front().buf != front) {
+        index_.clear();
+        index_.push_back({base_, front});
+        // 旧游标指向的块已失效，下次读取前按绝对位置重新定位
+        cursor_valid_ = false;
+    }
+
+    const IndexEntry last = index_.back();
+    length_ = last.start + last.buf->length();
+    for (auto *buf = last.buf->next(); buf != front; buf = buf->next()) {
+        index_.push_back({length_, buf});
+        length_ += buf->length();
+    }
+}
+
+void ChainSource::ensure_cursor() {
+    refresh_index();
+    if (!cursor_valid_) {
+        locate(std::clamp(pos_, base_, length_));
+    }
+}
+
+void ChainSource::locate(size_t pos) {
+    pos_ = pos;
+    cursor_valid_ = true;
+    if (index_.empty()) {
+        cursor_index_ = 0;
+        offset_ = 0;
+        return;
+    }
+    auto it = std::upper_bound(index_.begin(), index_.end(), pos,
+                               [](size_t value, const IndexEntry &entry) { return value < entry.start; });
+    cursor_index_ = static_cast<size_t>(it - index_.begin()) - 1;
+    offset_ = pos - index_[cursor_index_].start;
+}
+
+std::span<const uint8_t> ChainSource::peek(size_t max_bytes) {
+    ensure_cursor();
+    while (pos_ < length_) {
+        const folly::IOBuf *buf = index_[cursor_index_].buf;
+        if (offset_ >= buf->length()) {
+            // 当前块已读完（或为空块），进入下一块
+            cursor_index_++;
+            offset_ = 0;
+            continue;
+        }
+        return {buf->data() + offset_, std::min(max_bytes, buf->length() - offset_)};
+    }
+    return {};
+}
+
+bool ChainSource::seek(size_t pos) {
+    ensure_cursor();
+    if (pos > length_ || pos < base_) {
+        return false;
+    }
+    if (pos >= pos_ && !index_.empty()) {
+        // 向前移动时沿游标推进，通常只跨越一两个块
+        size_t remaining = pos - pos_;
+        while (remaining > 0) {
+            size_t in_block = index_[cursor_index_].buf->length() - offset_;
+            if (remaining < in_block || cursor_index_ + 1 == index_.size()) {
+                offset_ += remaining;
+                break;
+            }
+            remaining -= in_block;
+            cursor_index_++;
+            offset_ = 0;
+        }
+        pos_ = pos;
+        return true;
+    }
+    locate(pos);
+    return true;
+}
+
+size_t ChainSource::trim_consumed(size_t keep_behind) {
+    ensure_cursor();
+    if (pos_ < base_ + keep_behind) {
+        return 0;
+    }
+    size_t limit = pos_ - keep_behind;
+    size_t released = 0;
+    // 只释放整块，且保留游标所在的块
+    while (cursor_index_ > 0) {
+        size_t block_end = index_.size() > 1 ? index_[1].start : length_;
+        if (block_end > limit) {
+            break;
+        }
+        queue_->pop_front();
+        released += block_end - base_;
+        base_ = block_end;
+        index_.erase(index_.begin());
+        cursor_index_--;
+    }
+    return released;
+}
+
+size_t ChainSource::available() const {
+    refresh_index();
+    return length_ > pos_ ? length_ - pos_ : 0;
+}
+
+size_t ChainSource::total_size() const {
+    if (!is_complete()) {
+        return UNKNOWN_SIZE;
+    }
+    refresh_index();
+    return length_;
+}
+
+// ---------------- RangedHttpSource ----------------
+
+std::shared_ptr<RangedHttpSource> RangedHttpSource::create(std::string url, size_t total_size, size_t fetch_size) {
+    return std::shared_ptr<RangedHttpSource>(new RangedHttpSource(std::move(url), total_size, fetch_size));
+}
+
+RangedHttpSource::RangedHttpSource(std::string url, size_t total_size, size_t fetch_size)
+        : url_(std::move(url)), total_size_(total_size), fetch_size_(fetch_size) {
+    mark_complete();
+}
+
+RangedHttpSource::~RangedHttpSource() {
+    std::map<size_t, std::shared_ptr<RangeRequest>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(in_flight_);
+    }
+    for (auto &[offset, request]: pending) {
+        CurlMultiManager::getInstance().cancelTask(request->handle.get());
+    }
+}
+
+std::map<size_t, std::vector<uint8_t>>::const_iterator RangedHttpSource::find_segment(size_t pos) const {
+    auto it = segments_.upper_bound(pos);
+    if (it == segments_.begin()) {
+        return segments_.end();
+    }
+    --it;
+    if (pos < it->first + it->second.size()) {
+        return it;
+    }
+    return segments_.end();
+}
+
+size_t RangedHttpSource::covered_end(size_t offset) const {
+    auto seg = find_segment(offset);
+    if (seg != segments_.end()) {
+        return seg->first + seg->second.size();
+    }
+    auto it = in_flight_.upper_bound(offset);
+    if (it == in_flight_.begin()) {
+        return offset;
+    }
+    --it;
+    size_t request_end = it->first + it->second->length;
+    return offset < request_end ? request_end : offset;
+}
+
+std::span<const uint8_t> RangedHttpSource::peek(size_t max_bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = find_segment(pos_);
+        if (it != segments_.end()) {
+            size_t offset = pos_ - it->first;
+            // 区段写入后不再变动，可以在锁外使用
+            return {it->second.data() + offset, std::min(max_bytes, it->second.size() - offset)};
+        }
+    }
+    if (pos_ < total_size_) {
+        prefetch(pos_, fetch_size_);
+    }
+    return {};
+}
+
+bool RangedHttpSource::seek(size_t pos) {
+    if (pos > total_size_) {
+        return false;
+    }
+    pos_ = pos;
+    return true;
+}
+
+size_t RangedHttpSource::available() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t pos = pos_;
+    // 累加从当前位置起首尾相接的区段
+    for (auto it = find_segment(pos); it != segments_.end() && it->first <= pos; ++it) {
+        pos = it->first + it->second.size();
+    }
+    return pos - pos_;
+}
+
+void RangedHttpSource::add_segment(size_t offset, std::vector<uint8_t> data) {
+    if (data.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        segments_.emplace(offset, std::move(data));
+    }
+    if (on_data_) {
+        on_data_();
+    }
+}
+
+void RangedHttpSource::prefetch(size_t offset, size_t length) {
+    if (has_failed()) {
+        // 失败的区段不会被记录为已覆盖，继续请求只会反复重试同一段
+        return;
+    }
+    size_t end = std::min(total_size_, offset + length);
+    std::vector<std::shared_ptr<RangeRequest>> requests;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t pos = offset;
+        while (pos < end) {
+            // 跳过已覆盖的部分：直接跳到所在区段或请求的末尾
+            if (size_t covered = covered_end(pos); covered > pos) {
+                pos = covered;
+                continue;
+            }
+            // 请求长度截止到下一个已有区段，保持区段之间互不重叠
+            size_t request_end = std::min(end, pos + fetch_size_);
+            auto next_segment = segments_.upper_bound(pos);
+            if (next_segment != segments_.end()) {
+                request_end = std::min(request_end, next_segment->first);
+            }
+            auto next_request = in_flight_.upper_bound(pos);
+            if (next_request != in_flight_.end()) {
+                request_end = std::min(request_end, next_request->first);
+            }
+
+            auto request = std::make_shared<RangeRequest>();
+            request->offset = pos;
+            request->length = request_end - pos;
+            request->data.reserve(request->length);
+            in_flight_.emplace(pos, request);
+            requests.push_back(request);
+            pos = request_end;
+        }
+    }
+
+    for (auto &request: requests) {
+        size_t request_end = request->offset + request->length;
+        request->handle = std::shared_ptr<CURL>(curl_easy_init(), curl_easy_cleanup);
+        CURL *curl = request->handle.get();
+        std::string range = std::to_string(request->offset) + "-" + std::to_string(request_end - 1);
+        curl_easy_setopt(curl, CURLOPT_URL, url_.c_str());
+        curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+        curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 2L);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, range_write_callback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, request.get());
+        // 与顺序下载相同的低速限制，服务端卡住时请求会失败而不是一直挂着
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 10L); // 10秒
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1024L * 320 / 8); // 320kbps
+        if (request_options_) {
+            request_options_(curl);
+        }
+
+        VLOG(1) << "[RangedHttpSource] 请求区段 " << range;
+        std::weak_ptr<RangedHttpSource> weak_self = weak_from_this();
+        CurlMultiManager::getInstance().addTask(request->handle, [weak_self, request](CURLcode result,
+                                                                                      const std::string &) {
+            if (auto self = weak_self.lock()) {
+                self->on_range_finished(request, result);
+            }
+        });
+    }
+}
+
+void RangedHttpSource::close() {
+    failed_.store(true, std::memory_order_release);
+    std::map<size_t, std::shared_ptr<RangeRequest>> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.swap(in_flight_);
+    }
+    for (auto &[offset, request]: pending) {
+        CurlMultiManager::getInstance().cancelTask(request->handle.get());
+    }
+    if (on_data_) {
+        on_data_();
+    }
+}
+
+size_t RangedHttpSource::range_write_callback(void *ptr, size_t size, size_t nmemb, void *userdata) {
+    auto *request = static_cast<RangeRequest *>(userdata);
+    size_t total = size * nmemb;
+    size_t room = request->length - request->data.size();
+    if (total > room) {
+        // 服务端忽略了 Range 返回整个文件，中止该请求
+        return 0;
+    }
+    auto *bytes = static_cast<const uint8_t *>(ptr);
+    request->data.insert(request->data.end(), bytes, bytes + total);
+    return total;
+}
+
+void RangedHttpSource::on_range_finished(const std::shared_ptr<RangeRequest> &request, CURLcode result) {
+    long http_code = 0;
+    curl_easy_getinfo(request->handle.get(), CURLINFO_RESPONSE_CODE, &http_code);
+
+    bool ok = result == CURLE_OK && http_code == 206 && !request->data.empty();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        in_flight_.erase(request->offset);
+        if (ok) {
+            segments_.emplace(request->offset, std::move(request->data));
+        }
+    }
+
+    if (!ok) {
+        LOG(ERROR) << "[RangedHttpSource] 区段请求失败，offset=" << request->offset << "，HTTP " << http_code
+                   << "，错误码 " << result;
+        failed_.store(true, std::memory_order_release);
+    }
+    if (on_data_) {
+        on_data_();
+    }
+}
+
+// ---------------- TailPatchedSource ----------------
+
+std::span<const uint8_t> TailPatchedSource::peek(size_t max_bytes) {
+    if (pos_ >= tail_offset_) {
+        size_t offset = pos_ - tail_offset_;
+        if (offset >= tail_.size()) {
+            return {};
+        }
+        return {tail_.data() + offset, std::min(max_bytes, tail_.size() - offset)};
+    }
+    // head 的位置在 seek 时可能因为数据还没下载到而没有跟上，这里补上
+    if (head_->tell() != pos_ && !head_->seek(pos_)) {
+        return {};
+    }
+    return head_->peek(std::min(max_bytes, tail_offset_ - pos_));
+}
+
+bool TailPatchedSource::seek(size_t pos) {
+    if (pos > total_size()) {
+        return false;
+    }
+    pos_ = pos;
+    if (pos < tail_offset_) {
+        // 允许先定位到尚未下载的位置，peek 时再同步 head
+        head_->seek(pos);
+    }
+    return true;
+}
+
+size_t TailPatchedSource::available() const {
+    if (pos_ >= tail_offset_) {
+        return total_size() - pos_;
+    }
+    size_t frontier = head_->tell() + head_->available();
+    if (frontier >= tail_offset_) {
+        return tail_offset_ - pos_ + tail_.size();
+    }
+    return frontier > pos_ ? frontier - pos_ : 0;
+}
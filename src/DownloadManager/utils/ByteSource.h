@@ -0,0 +1,268 @@
+// ByteSource.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+#include <curl/curl.h>
+#include <folly/io/IOBufQueue.h>
+#include "AudioDataBuffer.h"
+
+/**
+ * @brief 解码器统一使用的数据源接口
+ *        peek 借出从当前位置开始的一段连续只读数据，不拷贝也不移动位置；借出的 span 在下一次 seek/advance 前有效。
+ *        read_into 拷贝并前移，seek 跳到绝对位置。数据源可以边下载边增长，mark_complete 之后不再增长。
+ *        读取相关接口只允许单个消费者调用。
+ */
+class ByteSource {
+public:
+    static constexpr size_t UNKNOWN_SIZE = SIZE_MAX;
+
+    virtual ~ByteSource() = default;
+
+    // 借出当前位置起最多 max_bytes 的连续数据，暂无数据时返回空 span
+    virtual std::span<const uint8_t> peek(size_t max_bytes) = 0;
+
+    // 跳到绝对位置，超出可定位范围时返回 false 且位置不变
+    virtual bool seek(size_t pos) = 0;
+
+    // 当前位置起已经就绪、可以立即读取的字节数
+    [[nodiscard]] virtual size_t available() const = 0;
+
+    // 数据总长度，未知时返回 UNKNOWN_SIZE
+    [[nodiscard]] virtual size_t total_size() const = 0;
+
+    // 拷贝最多 size 字节并前移，返回实际拷贝的字节数
+    virtual size_t read_into(void *buffer, size_t size);
+
+    // 已经读到末尾且不会再有新数据
+    [[nodiscard]] virtual bool is_eof() const;
+
+    bool advance(size_t bytes) { return seek(pos_ + bytes); }
+
+    [[nodiscard]] size_t tell() const { return pos_; }
+
+    // 下载端写完后调用
+    void mark_complete() { complete_.store(true, std::memory_order_release); }
+
+    [[nodiscard]] bool is_complete() const { return complete_.load(std::memory_order_acquire); }
+
+    // 全部数据都已在本地内存中，读取和 seek 不会再等待下载
+    [[nodiscard]] virtual bool is_fully_resident() const { return is_complete(); }
+
+protected:
+    size_t pos_ = 0;
+    std::atomic<bool> complete_{false};
+};
+
+/**
+ * @brief 连续内存数据源：包装下载用的 FixedCapacityBuffer（可增长），或一段固定内存（直接完成）
+ */
+class MemorySource : public ByteSource {
+public:
+    explicit MemorySource(const FixedCapacityBuffer *buffer) : buffer_(buffer) {}
+
+    MemorySource(const uint8_t *data, size_t length) : data_(data), length_(length) {
+        mark_complete();
+    }
+
+    std::span<const uint8_t> peek(size_t max_bytes) override;
+
+    bool seek(size_t pos) override;
+
+    [[nodiscard]] size_t available() const override;
+
+    [[nodiscard]] size_t total_size() const override;
+
+protected:
+    MemorySource() = default;
+
+    void reset_view(const uint8_t *data, size_t length) {
+        data_ = data;
+        length_ = length;
+        pos_ = 0;
+    }
+
+    [[nodiscard]] const uint8_t *base() const { return buffer_ ? buffer_->data() : data_; }
+
+    [[nodiscard]] size_t current_size() const { return buffer_ ? buffer_->size() : length_; }
+
+private:
+    const FixedCapacityBuffer *buffer_ = nullptr;
+    const uint8_t *data_ = nullptr;
+    size_t length_ = 0;
+};
+
+/**
+ * @brief 只读 mmap 的本地文件数据源，打开即完成
+ */
+class MmapFileSource : public MemorySource {
+public:
+    explicit MmapFileSource(const std::string &path);
+
+    ~MmapFileSource() override;
+
+    [[nodiscard]] bool is_open() const { return mapping_ != nullptr; }
+
+    MmapFileSource(const MmapFileSource &) = delete;
+
+    MmapFileSource &operator=(const MmapFileSource &) = delete;
+
+private:
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+};
+
+/**
+ * @brief IOBuf 链数据源（流式下载）
+ *        读取位置用“块索引 + 块内偏移”的游标保存，追加数据后依然有效；
+ *        另外维护一份按起始偏移排序的块索引（rope index），seek 时二分查找。
+ *        读取不会消费链上的数据，因此可以向回 seek；直播流需要定期 trim_consumed 释放已读过的块。
+ */
+class ChainSource : public ByteSource {
+public:
+    explicit ChainSource(folly::IOBufQueue *queue) : queue_(queue) {}
+
+    std::span<const uint8_t> peek(size_t max_bytes) override;
+
+    bool seek(size_t pos) override;
+
+    [[nodiscard]] size_t available() const override;
+
+    [[nodiscard]] size_t total_size() const override;
+
+    // 释放读取位置 keep_behind 字节之前的整块数据，之后不能再 seek 回这些位置；调用方需与下载侧互斥
+    size_t trim_consumed(size_t keep_behind);
+
+private:
+    struct IndexEntry {
+        size_t start;              // 该块在整个数据流中的起始偏移
+        const folly::IOBuf *buf;
+    };
+
+    folly::IOBufQueue *queue_;
+    mutable std::vector<IndexEntry> index_;
+    mutable size_t length_ = 0;  // 数据流的末尾偏移（包含已释放的部分）
+    size_t base_ = 0;            // 队首块的起始偏移，trim_consumed 后增长
+    size_t cursor_index_ = 0;    // 当前读取的块在 index_ 中的下标
+    size_t offset_ = 0;          // 当前块内的读取偏移
+    mutable bool cursor_valid_ = true;
+
+    // 增量索引新追加的块，最后一块原地增长的部分也会计入；队首变化（队列被重置）时整体重建
+    void refresh_index() const;
+
+    void ensure_cursor();
+
+    void locate(size_t pos);
+};
+
+/**
+ * @brief 通过 HTTP Range 请求按需拉取的远程数据源
+ *        已拉取的区段按起始偏移保存在 segments_ 中，区段一旦写入就不再修改或释放，借出的 span 在数据源生命周期内有效。
+ *        peek 未命中时发起异步 Range 请求并返回空 span，数据到达后在 curl 线程上调用 on_data 回调。
+ */
+class RangedHttpSource : public ByteSource, public std::enable_shared_from_this<RangedHttpSource> {
+public:
+    static constexpr size_t DEFAULT_FETCH_SIZE = 256 * 1024;
+
+    static std::shared_ptr<RangedHttpSource> create(std::string url, size_t total_size,
+                                                    size_t fetch_size = DEFAULT_FETCH_SIZE);
+
+    ~RangedHttpSource() override;
+
+    std::span<const uint8_t> peek(size_t max_bytes) override;
+
+    bool seek(size_t pos) override;
+
+    [[nodiscard]] size_t available() const override;
+
+    [[nodiscard]] size_t total_size() const override { return total_size_; }
+
+    [[nodiscard]] bool is_eof() const override { return pos_ >= total_size_; }
+
+    // 长度固定但数据按需取回
+    [[nodiscard]] bool is_fully_resident() const override { return false; }
+
+    // 放入已经持有的数据（例如顺序下载已经拿到的开头部分）
+    void add_segment(size_t offset, std::vector<uint8_t> data);
+
+    // 确保 [offset, offset + length) 已经拉取或正在拉取
+    void prefetch(size_t offset, size_t length);
+
+    // 设置 curl 选项的回调（Cookie、Referer 等），每个 Range 请求创建句柄时调用
+    void set_request_options(std::function<void(CURL *)> options) { request_options_ = std::move(options); }
+
+    // 新区段到达时在 curl 线程上调用
+    void set_data_callback(std::function<void()> on_data) { on_data_ = std::move(on_data); }
+
+    // 取消进行中的请求并视为失败，之后不再发起新请求；数据回调会被调用一次，唤醒等待者
+    void close();
+
+    // 是否有 Range 请求失败（服务端不支持 Range 或网络错误），失败后不再发起新的请求
+    [[nodiscard]] bool has_failed() const { return failed_.load(std::memory_order_acquire); }
+
+private:
+    RangedHttpSource(std::string url, size_t total_size, size_t fetch_size);
+
+    struct RangeRequest {
+        size_t offset;
+        size_t length; // 请求的字节数；data.capacity() 可能比它大，不能用来推算区段末尾
+        std::vector<uint8_t> data;
+        std::shared_ptr<CURL> handle;
+    };
+
+    static size_t range_write_callback(void *ptr, size_t size, size_t nmemb, void *userdata);
+
+    void on_range_finished(const std::shared_ptr<RangeRequest> &request, CURLcode result);
+
+    // 需持有 mutex_：返回包含 pos 的区段
+    [[nodiscard]] std::map<size_t, std::vector<uint8_t>>::const_iterator find_segment(size_t pos) const;
+
+    // 需持有 mutex_：offset 所在的已有区段或进行中请求的末尾，未覆盖时返回 offset
+    [[nodiscard]] size_t covered_end(size_t offset) const;
+
+    std::string url_;
+    size_t total_size_;
+    size_t fetch_size_;
+
+    mutable std::mutex mutex_; // 保护 segments_ 与 in_flight_，curl 线程写入、消费者读取
+    std::map<size_t, std::vector<uint8_t>> segments_;
+    std::map<size_t, std::shared_ptr<RangeRequest>> in_flight_;
+
+    std::function<void(CURL *)> request_options_;
+    std::function<void()> on_data_;
+    std::atomic<bool> failed_{false};
+};
+
+/**
+ * @brief 头部来自顺序下载、尾部已单独取回的数据源
+ *        用于 moov 位于文件末尾的 MP4：[0, tail_offset) 读 head，[tail_offset, 末尾) 读预先用 Range 请求取回的 tail。
+ *        总长度已知，FFmpeg 可以直接 seek 到尾部解析 moov，再回到开头边下载边解码 mdat。
+ */
+class TailPatchedSource : public ByteSource {
+public:
+    TailPatchedSource(std::unique_ptr<ByteSource> head, size_t tail_offset, std::vector<uint8_t> tail)
+        : head_(std::move(head)), tail_offset_(tail_offset), tail_(std::move(tail)) {}
+
+    std::span<const uint8_t> peek(size_t max_bytes) override;
+
+    bool seek(size_t pos) override;
+
+    [[nodiscard]] size_t available() const override;
+
+    [[nodiscard]] size_t total_size() const override { return tail_offset_ + tail_.size(); }
+
+    [[nodiscard]] bool is_eof() const override { return pos_ >= total_size(); }
+
+private:
+    std::unique_ptr<ByteSource> head_;
+    size_t tail_offset_;
+    std::vector<uint8_t> tail_;
+};
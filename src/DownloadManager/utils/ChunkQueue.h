@@ -0,0 +1,163 @@
+// ChunkQueue.h
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <memory>
+#include <folly/io/IOBuf.h>
+#include <folly/io/IOBufQueue.h>
+#include <coro/coro.hpp>
+#include "SpscRing.h"
+
+/**
+ * @brief curl 写回调与解码侧之间的数据块队列（单生产者单消费者，仅使用原子操作）
+ *        生产者（CurlMultiManager 线程）把小块写入先攒在私有暂存区，够 PUBLISH_THRESHOLD 后合并为一个 IOBuf 无等待发布；
+ *        消费者（AudioSender 侧协程）在读取前把已发布的块并入自己的 IOBufQueue。
+ *        消费者没有数据可读时挂起在 wait_for_data 上，生产者发布后把协程句柄交给线程池恢复，
+ *        不会在 curl 线程上继续执行解码逻辑。
+ */
+class ChunkQueue {
+public:
+    static constexpr size_t PUBLISH_THRESHOLD = 32 * 1024;      // 攒够多少字节再发布，减少碎片
+    static constexpr size_t MAX_BUFFERED_BYTES = 5 * 1024 * 1024; // 超过后让 curl 暂停接收
+    static constexpr size_t MAX_CHUNKS = 256;
+
+    ChunkQueue() = default;
+
+    ChunkQueue(const ChunkQueue &) = delete;
+
+    ChunkQueue &operator=(const ChunkQueue &) = delete;
+
+    // ---------- 生产者（curl 线程） ----------
+
+    // 缓冲已满时返回 false，调用方应返回 CURL_WRITEFUNC_PAUSE，curl 会在恢复后重新投递这段数据
+    bool append(const void *data, size_t size) {
+        if (buffered_bytes() >= MAX_BUFFERED_BYTES) {
+            return false;
+        }
+        staging_.append(data, size);
+        if (staging_.chainLength() >= PUBLISH_THRESHOLD) {
+            publish_staging();
+        }
+        return true;
+    }
+
+    // 下载结束时调用：发布暂存区剩余数据并标记结束
+    void finish() {
+        if (!staging_.empty()) {
+            auto rest = staging_.move();
+            rest->coalesce();
+            if (!publish(rest)) {
+                // publish 失败时已撤回计数，这里重新计入，drain_into 取走 tail 时会一并减去
+                queued_bytes_.fetch_add(rest->length(), std::memory_order_acq_rel);
+                tail_ = std::move(rest);
+                tail_ready_.store(true, std::memory_order_release);
+            }
+        }
+        close();
+    }
+
+    // 标记不会再有数据（下载结束或被跳过），唤醒等待中的消费者；任意线程可调用
+    void close() {
+        finished_.store(true, std::memory_order_release);
+        wake_consumer();
+    }
+
+    // ---------- 消费者 ----------
+
+    // 把已发布的块全部并入 queue，返回并入的字节数
+    size_t drain_into(folly::IOBufQueue &queue) {
+        size_t drained = 0;
+        while (auto chunk = chunks_.try_pop()) {
+            drained += (*chunk)->length();
+            queue.append(std::move(*chunk));
+        }
+        if (chunks_.empty() && tail_ready_.exchange(false, std::memory_order_acq_rel)) {
+            drained += tail_->length();
+            queue.append(std::move(tail_));
+        }
+        queued_bytes_.fetch_sub(drained, std::memory_order_acq_rel);
+        // 读取不会消费 queue，未读量由消费侧 report_backlog 校正，这里只累加新并入的部分
+        consumer_backlog_.fetch_add(drained, std::memory_order_acq_rel);
+        return drained;
+    }
+
+    // 消费侧读完数据后上报剩余量，用于生产者背压判断
+    void report_backlog(size_t bytes) {
+        consumer_backlog_.store(bytes, std::memory_order_release);
+    }
+
+    [[nodiscard]] bool has_data() const {
+        return !chunks_.empty() || finished_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool finished() const { return finished_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] size_t buffered_bytes() const {
+        return queued_bytes_.load(std::memory_order_acquire) + consumer_backlog_.load(std::memory_order_acquire);
+    }
+
+    // 等待生产者发布新数据或下载结束，唤醒后在 pool 上继续执行
+    auto wait_for_data(coro::thread_pool &pool) {
+        struct Awaiter {
+            ChunkQueue &queue;
+            coro::thread_pool &pool;
+
+            bool await_ready() const { return queue.has_data(); }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                queue.waiter_pool_ = &pool;
+                queue.waiter_.store(handle.address(), std::memory_order_seq_cst);
+                // 复查，避免生产者在登记之前发布导致丢失唤醒
+                if (queue.has_data() && queue.waiter_.exchange(nullptr, std::memory_order_seq_cst) != nullptr) {
+                    return false;
+                }
+                return true;
+            }
+
+            void await_resume() const {}
+        };
+        return Awaiter{*this, pool};
+    }
+
+private:
+    void publish_staging() {
+        auto chunk = staging_.move();
+        chunk->coalesce();
+        if (!publish(chunk)) {
+            // 队列满，放回暂存区等下一次
+            staging_.append(std::move(chunk));
+        }
+    }
+
+    bool publish(std::unique_ptr<folly::IOBuf> &chunk) {
+        size_t length = chunk->length();
+        // 先计数再入队，消费者取走后减去时不会出现下溢
+        queued_bytes_.fetch_add(length, std::memory_order_acq_rel);
+        if (!chunks_.try_push(std::move(chunk))) {
+            queued_bytes_.fetch_sub(length, std::memory_order_acq_rel);
+            return false;
+        }
+        wake_consumer();
+        return true;
+    }
+
+    void wake_consumer() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (void *address = waiter_.exchange(nullptr, std::memory_order_seq_cst)) {
+            waiter_pool_->resume(std::coroutine_handle<>::from_address(address));
+        }
+    }
+
+    folly::IOBufQueue staging_{folly::IOBufQueue::cacheChainLength()}; // 仅生产者访问
+    std::unique_ptr<folly::IOBuf> tail_; // 结束时放不进队列的剩余数据，tail_ready_ 之后归消费者
+    SpscRing<std::unique_ptr<folly::IOBuf>> chunks_{MAX_CHUNKS};
+
+    std::atomic<size_t> queued_bytes_{0};
+    std::atomic<size_t> consumer_backlog_{0};
+    std::atomic<bool> finished_{false};
+    std::atomic<bool> tail_ready_{false};
+
+    std::atomic<void *> waiter_{nullptr};
+    coro::thread_pool *waiter_pool_ = nullptr;
+};
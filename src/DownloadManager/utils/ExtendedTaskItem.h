@@ -1,6 +1,9 @@
 // ExtendedTaskItem.h
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <variant>
 #include <optional>
@@ -8,6 +11,9 @@
 #include <curl/curl.h>
 #include "../TaskManager.h"
 #include "AudioTypes.h"
+#include "ChunkQueue.h"
+#include "Mp3FrameIndex.h"
+#include "../AudioSender/StreamMetrics.h"
 #include "../../ConfigManager.h"
 
 enum class ReaderErrorCode {
@@ -31,14 +37,59 @@ struct ExtendedTaskItem {
 
     std::variant<FixedCapacityBuffer, folly::IOBufQueue> data = FixedCapacityBuffer(
             ConfigManager::getInstance().getConfig().default_buffer_size);
-    folly::IOBufQueue iobuf_write_queue{folly::IOBufQueue::cacheChainLength()};
-    coro::mutex mutex_data;
+    ChunkQueue chunks; // 流式下载时 curl 线程写入，消费侧并入 data 中的 IOBufQueue
+    coro::mutex mutex_data; // 只在 AudioSender 侧的协程之间使用，curl 线程不再持有
+    Mp3FrameIndex mp3_index; // curl 线程边下载边建立，识别出不是 MP3 后停用
+
+    StreamMetrics *metrics = nullptr; // 所属流的指标，curl 线程累计下载字节数
 
     size_t total_size = 0;
+    std::atomic<size_t> expected_size{0}; // 响应头中的 Content-Length，未知为 0
+
+    // 实际下载地址与附加的请求选项（Cookie 等），Range 请求需要沿用
+    std::string effective_url;
+    std::function<void(CURL *)> request_options;
 
     coro::event EventDownloadFinished;
     coro::event EventReadFinished;
 
+    // 下载侧按字节阈值唤醒：消费侧登记阈值后挂起，curl 线程累计收到的字节越过阈值或下载结束时 set，只允许一个等待者
+    std::atomic<size_t> received_bytes{0};
+    std::atomic<size_t> wake_threshold{SIZE_MAX};
+    std::atomic<bool> receiving{true};
+    coro::event EventBytesReached;
+
+    // curl 线程调用：记录已接收的数据
+    void publish_received(size_t bytes) {
+        size_t received = received_bytes.fetch_add(bytes) + bytes;
+        size_t threshold = wake_threshold.load();
+        if (received >= threshold && wake_threshold.compare_exchange_strong(threshold, SIZE_MAX)) {
+            EventBytesReached.set();
+        }
+    }
+
+    // 下载成功、失败或任务被跳过后调用，之后不会再有新数据
+    void close_received() {
+        receiving = false;
+        wake_threshold = SIZE_MAX;
+        EventBytesReached.set();
+    }
+
+    [[nodiscard]] bool is_receiving() const { return receiving.load(); }
+
+    // 等到累计收到 threshold 字节或下载结束，之后切回 executor
+    template<typename Executor>
+    coro::task<void> wait_for_bytes(Executor &executor, size_t threshold) {
+        EventBytesReached.reset();
+        wake_threshold = threshold;
+        if (received_bytes.load() >= threshold || !receiving.load()) {
+            wake_threshold = SIZE_MAX;
+            co_return;
+        }
+        co_await EventBytesReached;
+        co_await executor.schedule();
+    }
+
     std::optional<ReaderErrorInfo> read_error;
 
     void set_read_error(ReaderErrorCode code, const std::string &message) {
@@ -81,4 +132,11 @@ struct ExtendedTaskItem {
     bool isIOBufQueue() const {
         return std::holds_alternative<folly::IOBufQueue>(data);
     }
+
+    // 消费侧调用：把 curl 线程已发布的数据块并入 IOBufQueue，调用方需持有 mutex_data
+    void drainChunks() {
+        if (auto *queue = std::get_if<folly::IOBufQueue>(&data)) {
+            chunks.drain_into(*queue);
+        }
+    }
 };
@@ -0,0 +1,250 @@
+#include "Mp3FrameIndex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <glog/logging.h>
+
+namespace {
+    // 比特率表（kbps），下标为帧头中的 bitrate_index
+    constexpr int kBitrateV1L1[16] = {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0};
+    constexpr int kBitrateV1L2[16] = {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0};
+    constexpr int kBitrateV1L3[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+    constexpr int kBitrateV2L1[16] = {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0};
+    constexpr int kBitrateV2L23[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+
+    constexpr int kSampleRateV1[3] = {44100, 48000, 32000};
+
+    uint32_t read_be32(const uint8_t *p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+}
+
+bool Mp3FrameIndex::parse_header(uint32_t word, FrameHeader &header) {
+    if ((word >> 21) != 0x7FF) {
+        return false;
+    }
+    int version_bits = static_cast<int>((word >> 19) & 0x3);
+    int layer_bits = static_cast<int>((word >> 17) & 0x3);
+    int bitrate_index = static_cast<int>((word >> 12) & 0xF);
+    int rate_index = static_cast<int>((word >> 10) & 0x3);
+    int padding = static_cast<int>((word >> 9) & 0x1);
+    if (version_bits == 1 || layer_bits == 0 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        // 保留值或自由格式，不参与索引
+        return false;
+    }
+
+    header.version = version_bits == 3 ? 1 : (version_bits == 2 ? 2 : 3);
+    header.layer = 4 - layer_bits;
+    header.sample_rate = kSampleRateV1[rate_index] >> (header.version - 1);
+    header.mono = ((word >> 6) & 0x3) == 3;
+
+    int kbps;
+    if (header.version == 1) {
+        kbps = header.layer == 1 ? kBitrateV1L1[bitrate_index]
+                                 : (header.layer == 2 ? kBitrateV1L2[bitrate_index] : kBitrateV1L3[bitrate_index]);
+    } else {
+        kbps = header.layer == 1 ? kBitrateV2L1[bitrate_index] : kBitrateV2L23[bitrate_index];
+    }
+    int bitrate = kbps * 1000;
+
+    if (header.layer == 1) {
+        header.samples = 384;
+        header.frame_length = (12 * bitrate / header.sample_rate + padding) * 4;
+    } else if (header.layer == 2 || header.version == 1) {
+        header.samples = 1152;
+        header.frame_length = 144 * bitrate / header.sample_rate + padding;
+    } else {
+        header.samples = 576;
+        header.frame_length = 72 * bitrate / header.sample_rate + padding;
+    }
+    return header.frame_length > 4;
+}
+
+void Mp3FrameIndex::scan(const uint8_t *data, size_t length) {
+    if (disabled_.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    size_t i = 0;
+    while (i < length) {
+        if (skip_ > 0) {
+            // 跳过帧体（或 ID3 标签），只在需要时截取候选帧开头
+            size_t take = static_cast<size_t>(std::min<uint64_t>(skip_, length - i));
+            if (capturing_tag_ && tag_length_ < sizeof(tag_buffer_)) {
+                size_t copy = std::min(take, sizeof(tag_buffer_) - tag_length_);
+                std::memcpy(tag_buffer_ + tag_length_, data + i, copy);
+                tag_length_ += copy;
+            }
+            i += take;
+            position_ += take;
+            skip_ -= take;
+            if (skip_ == 0) {
+                if (skipping_id3_) {
+                    skipping_id3_ = false;
+                    data_start_.store(position_, std::memory_order_release);
+                    expected_next_ = position_;
+                } else {
+                    on_frame_end();
+                }
+            }
+            continue;
+        }
+
+        uint8_t byte = data[i++];
+        if (position_ < sizeof(id3_)) {
+            id3_[position_] = byte;
+        }
+        position_++;
+        window_ = (window_ << 8) | byte;
+        window_length_ = std::min(window_length_ + 1, 4);
+
+        if (position_ == sizeof(id3_) && std::memcmp(id3_, "ID3", 3) == 0) {
+            // ID3v2 标签：大小为 synchsafe 整数，带 footer 时再加 10 字节
+            uint64_t size = (static_cast<uint64_t>(id3_[6] & 0x7F) << 21) | ((id3_[7] & 0x7F) << 14) |
+                            ((id3_[8] & 0x7F) << 7) | (id3_[9] & 0x7F);
+            if (id3_[5] & 0x10) {
+                size += 10;
+            }
+            window_length_ = 0;
+            if (size > 0) {
+                skip_ = size;
+                skipping_id3_ = true;
+            } else {
+                data_start_.store(position_, std::memory_order_release);
+                expected_next_ = position_;
+            }
+            continue;
+        }
+
+        FrameHeader header;
+        if (window_length_ == 4 && parse_header(window_, header)) {
+            on_header(position_ - 4, header);
+            continue;
+        }
+
+        // 从 ID3v2 标签之后开始计算，内嵌大封面的文件不会在第一帧之前就放弃
+        if (!locked_.load(std::memory_order_relaxed) &&
+            position_ - data_start_.load(std::memory_order_relaxed) > GIVE_UP_BYTES) {
+            VLOG(1) << "[Mp3FrameIndex] 未能锁定 MP3 帧，停止扫描";
+            disable();
+            return;
+        }
+    }
+}
+
+void Mp3FrameIndex::on_header(uint64_t offset, const FrameHeader &header) {
+    bool locked = locked_.load(std::memory_order_relaxed);
+    bool same_stream = header.version == reference_.version && header.layer == reference_.layer &&
+                       header.sample_rate == reference_.sample_rate;
+
+    if (locked) {
+        if (!same_stream) {
+            // 帧体中恰好出现的伪帧头，继续逐字节搜索
+            return;
+        }
+    } else if (!same_stream || offset != expected_next_ || candidates_.empty()) {
+        // 开始新的候选链
+        candidates_.clear();
+        reference_ = header;
+        tag_length_ = 0;
+        capturing_tag_ = true;
+    } else {
+        capturing_tag_ = false;
+    }
+
+    current_ = header;
+    if (!locked) {
+        candidates_.push_back({offset, false});
+    } else {
+        record_frame(offset);
+    }
+    window_length_ = 0;
+    skip_ = static_cast<uint64_t>(header.frame_length - 4);
+}
+
+void Mp3FrameIndex::on_frame_end() {
+    expected_next_ = position_;
+    if (locked_.load(std::memory_order_relaxed)) {
+        scanned_bytes_.store(position_, std::memory_order_release);
+        return;
+    }
+
+    if (candidates_.size() == 1) {
+        capturing_tag_ = false;
+        check_tag_frame();
+    }
+
+    if (static_cast<int>(candidates_.size()) >= LOCK_FRAMES) {
+        sample_rate_.store(reference_.sample_rate, std::memory_order_release);
+        samples_per_frame_.store(reference_.samples, std::memory_order_release);
+        locked_.store(true, std::memory_order_release);
+        for (const auto &candidate: candidates_) {
+            if (!candidate.is_tag) {
+                record_frame(candidate.offset);
+            }
+        }
+        candidates_.clear();
+        scanned_bytes_.store(position_, std::memory_order_release);
+        VLOG(1) << "[Mp3FrameIndex] 锁定 MPEG" << reference_.version << " Layer " << reference_.layer << "，"
+                << reference_.sample_rate << "Hz";
+    }
+}
+
+void Mp3FrameIndex::check_tag_frame() {
+    if (reference_.layer != 3) {
+        return;
+    }
+    // Xing/Info 位于 side info 之后，VBRI 固定在帧头后 32 字节
+    size_t side_info = reference_.version == 1 ? (reference_.mono ? 17 : 32) : (reference_.mono ? 9 : 17);
+    if (tag_length_ >= side_info + 8 &&
+        (std::memcmp(tag_buffer_ + side_info, "Xing", 4) == 0 || std::memcmp(tag_buffer_ + side_info, "Info", 4) == 0)) {
+        candidates_.front().is_tag = true;
+        uint32_t flags = read_be32(tag_buffer_ + side_info + 4);
+        if ((flags & 0x1) && tag_length_ >= side_info + 12) {
+            tag_frames_.store(read_be32(tag_buffer_ + side_info + 8), std::memory_order_release);
+        }
+        return;
+    }
+    if (tag_length_ >= 32 + 18 && std::memcmp(tag_buffer_ + 32, "VBRI", 4) == 0) {
+        candidates_.front().is_tag = true;
+        tag_frames_.store(read_be32(tag_buffer_ + 32 + 14), std::memory_order_release);
+    }
+}
+
+void Mp3FrameIndex::record_frame(uint64_t offset) {
+    uint64_t frame = frame_count_.load(std::memory_order_relaxed);
+    if (frame % FRAMES_PER_ENTRY == 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        offsets_.push_back(static_cast<int64_t>(offset));
+    }
+    frame_count_.store(frame + 1, std::memory_order_release);
+}
+
+uint64_t Mp3FrameIndex::total_samples() const {
+    if (!ready()) {
+        return 0;
+    }
+    auto samples = static_cast<uint64_t>(samples_per_frame());
+    if (uint64_t tag_frames = tag_frames_.load(std::memory_order_acquire)) {
+        return tag_frames * samples;
+    }
+    uint64_t frames = frame_count();
+    if (complete_.load(std::memory_order_acquire)) {
+        return frames * samples;
+    }
+    // 下载未完成：按已扫描字节占音频数据的比例外推
+    size_t expected = expected_size_.load(std::memory_order_acquire);
+    uint64_t scanned = scanned_bytes_.load(std::memory_order_acquire);
+    uint64_t data_start = data_start_.load(std::memory_order_acquire);
+    if (expected == 0 || scanned <= data_start || expected <= scanned) {
+        return frames * samples;
+    }
+    long double ratio = static_cast<long double>(expected - data_start) / static_cast<long double>(scanned - data_start);
+    return static_cast<uint64_t>(static_cast<long double>(frames * samples) * ratio);
+}
+
+std::vector<int64_t> Mp3FrameIndex::offsets() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return offsets_;
+}
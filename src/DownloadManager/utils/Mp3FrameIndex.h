@@ -0,0 +1,114 @@
+// Mp3FrameIndex.h
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief 下载过程中增量构建的 MP3 帧索引
+ *        curl 写回调按顺序把收到的字节交给 scan，扫描器只解析帧头并跳过帧体，
+ *        每 FRAMES_PER_ENTRY 帧记录一次帧头的绝对字节偏移，可直接交给 mpg123_set_index 做精确 seek。
+ *        连续 LOCK_FRAMES 个帧头一致后才锁定参数，避免把非 MP3 数据误判为帧；
+ *        音频数据（ID3v2 标签之后）超过 GIVE_UP_BYTES 仍未锁定则自动停用。scan 只允许单个生产者调用，查询接口可在任意线程调用。
+ */
+class Mp3FrameIndex {
+public:
+    static constexpr uint32_t FRAMES_PER_ENTRY = 16;
+    static constexpr int LOCK_FRAMES = 3;
+    static constexpr size_t GIVE_UP_BYTES = 256 * 1024;
+
+    Mp3FrameIndex() = default;
+
+    Mp3FrameIndex(const Mp3FrameIndex &) = delete;
+
+    Mp3FrameIndex &operator=(const Mp3FrameIndex &) = delete;
+
+    // ---------- 生产者（curl 线程） ----------
+
+    void scan(const uint8_t *data, size_t length);
+
+    // 下载完成，帧数不再增长
+    void finish() { complete_.store(true, std::memory_order_release); }
+
+    // Content-Length，用于下载完成前估算总时长
+    void set_expected_size(size_t bytes) { expected_size_.store(bytes, std::memory_order_release); }
+
+    // 确认不是 MP3 后停止扫描
+    void disable() { disabled_.store(true, std::memory_order_release); }
+
+    // ---------- 查询 ----------
+
+    // 已锁定帧参数且至少有一条索引
+    [[nodiscard]] bool ready() const {
+        return locked_.load(std::memory_order_acquire) && !disabled_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] int sample_rate() const { return sample_rate_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] int samples_per_frame() const { return samples_per_frame_.load(std::memory_order_acquire); }
+
+    [[nodiscard]] uint64_t frame_count() const { return frame_count_.load(std::memory_order_acquire); }
+
+    // 按源采样率计的总样本数：优先 Xing/VBRI 头给出的帧数，下载完成后为精确值，否则按已下载比例估算；未知返回 0
+    [[nodiscard]] uint64_t total_samples() const;
+
+    // 每 FRAMES_PER_ENTRY 帧一条的帧头字节偏移
+    [[nodiscard]] std::vector<int64_t> offsets() const;
+
+private:
+    struct FrameHeader {
+        int version = 0;          // 1 = MPEG1，2 = MPEG2，3 = MPEG2.5
+        int layer = 0;
+        int sample_rate = 0;
+        int frame_length = 0;
+        int samples = 0;
+        bool mono = false;
+    };
+
+    struct Candidate {
+        uint64_t offset;
+        bool is_tag;
+    };
+
+    static bool parse_header(uint32_t word, FrameHeader &header);
+
+    void on_header(uint64_t offset, const FrameHeader &header);
+
+    void on_frame_end();
+
+    void record_frame(uint64_t offset);
+
+    void check_tag_frame();
+
+    // 扫描状态，只由生产者访问
+    uint64_t position_ = 0;       // 下一个待处理字节的绝对偏移
+    uint64_t skip_ = 0;           // 当前帧（或 ID3 标签）剩余需要跳过的字节数
+    uint32_t window_ = 0;         // 搜索帧头时最近的 4 个字节
+    int window_length_ = 0;
+    uint8_t id3_[10]{};
+    uint64_t expected_next_ = 0;  // 上一帧结束的位置
+    FrameHeader reference_;       // 锁定（或候选链）使用的帧参数
+    FrameHeader current_;
+    std::vector<Candidate> candidates_;
+    uint8_t tag_buffer_[64]{};    // 候选链第一帧的帧体开头，用于识别 Xing/Info/VBRI
+    size_t tag_length_ = 0;
+    bool capturing_tag_ = false;
+    bool skipping_id3_ = false;
+
+    std::atomic<bool> locked_{false};
+    std::atomic<bool> disabled_{false};
+    std::atomic<bool> complete_{false};
+    std::atomic<int> sample_rate_{0};
+    std::atomic<int> samples_per_frame_{0};
+    std::atomic<uint64_t> frame_count_{0};
+    std::atomic<uint64_t> tag_frames_{0};     // Xing/VBRI 头记录的总帧数
+    std::atomic<uint64_t> scanned_bytes_{0};  // 最后一个完整帧的结束位置
+    std::atomic<uint64_t> data_start_{0};     // ID3v2 标签之后音频数据的起点，total_samples 外推时也要读取
+    std::atomic<size_t> expected_size_{0};
+
+    mutable std::mutex mutex_; // 保护 offsets_
+    std::vector<int64_t> offsets_;
+};
@@ -0,0 +1,74 @@
+// Mp4Layout.h
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include "ByteSource.h"
+
+/**
+ * @brief MP4/M4A 顶层 box 布局
+ *        只读取顶层 box 头，判断 moov 在 mdat 之前（faststart，可边下边播）还是在文件尾部（需要先取回尾部）。
+ */
+struct Mp4Layout {
+    enum class Kind {
+        Unknown,     // 已有数据还不足以判断
+        MoovFirst,   // moov 在 mdat 之前
+        MoovAtTail,  // mdat 在前，moov 在 tail_offset 之后
+        Invalid,     // 不是合法的顶层 box 结构
+    };
+
+    Kind kind = Kind::Unknown;
+    uint64_t moov_end = 0;     // MoovFirst：moov 结束的位置，至少下载到这里才能打开解码器
+    uint64_t tail_offset = 0;  // MoovAtTail：mdat 结束的位置，从这里到文件末尾需要用 Range 请求取回
+};
+
+// 从头遍历顶层 box，只使用已就绪的数据；调用前后数据源的读取位置不变
+inline Mp4Layout probe_mp4_layout(ByteSource &source) {
+    Mp4Layout layout;
+    const size_t saved = source.tell();
+    uint64_t offset = 0;
+
+    while (source.seek(static_cast<size_t>(offset))) {
+        uint8_t header[16];
+        if (source.available() < 8 || source.read_into(header, 8) != 8) {
+            break;
+        }
+        uint64_t size = (static_cast<uint64_t>(header[0]) << 24) | (header[1] << 16) | (header[2] << 8) | header[3];
+        uint64_t header_size = 8;
+        if (size == 1) {
+            // 64 位 largesize
+            if (source.available() < 8 || source.read_into(header + 8, 8) != 8) {
+                break;
+            }
+            size = 0;
+            for (int i = 8; i < 16; ++i) {
+                size = (size << 8) | header[i];
+            }
+            header_size = 16;
+        }
+
+        if (std::memcmp(header + 4, "moov", 4) == 0) {
+            layout.kind = Mp4Layout::Kind::MoovFirst;
+            layout.moov_end = size == 0 ? UINT64_MAX : offset + size;
+            break;
+        }
+        if (std::memcmp(header + 4, "mdat", 4) == 0) {
+            if (size == 0) {
+                // mdat 一直延伸到文件末尾，moov 只能在它前面，既然没遇到就是非法文件
+                layout.kind = Mp4Layout::Kind::Invalid;
+            } else {
+                layout.kind = Mp4Layout::Kind::MoovAtTail;
+                layout.tail_offset = offset + size;
+            }
+            break;
+        }
+        if (size < header_size) {
+            layout.kind = Mp4Layout::Kind::Invalid;
+            break;
+        }
+        offset += size;
+    }
+
+    source.seek(saved);
+    return layout;
+}
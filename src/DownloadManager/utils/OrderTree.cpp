@@ -0,0 +1,192 @@
+#include "OrderTree.h"
+#include <algorithm>
+
+const std::string &OrderTree::at(size_t index) const {
+    int node = root_;
+    while (true) {
+        size_t left_size = size_of(nodes_[node].left);
+        if (index < left_size) {
+            node = nodes_[node].left;
+        } else if (index == left_size) {
+            return nodes_[node].id;
+        } else {
+            index -= left_size + 1;
+            node = nodes_[node].right;
+        }
+    }
+}
+
+std::optional<size_t> OrderTree::index_of(const std::string &id) const {
+    auto it = index_.find(id);
+    if (it == index_.end()) {
+        return std::nullopt;
+    }
+    return position_of(it->second);
+}
+
+size_t OrderTree::position_of(int node) const {
+    // 自底向上累加：每次从右子树上来，左兄弟子树和父节点都排在前面
+    size_t index = size_of(nodes_[node].left);
+    while (nodes_[node].parent != NIL) {
+        int parent = nodes_[node].parent;
+        if (nodes_[parent].right == node) {
+            index += size_of(nodes_[parent].left) + 1;
+        }
+        node = parent;
+    }
+    return index;
+}
+
+bool OrderTree::insert(size_t index, const std::string &id) {
+    if (contains(id)) {
+        return false;
+    }
+    int node = allocate(id);
+    index_.emplace(id, node);
+    attach(node, std::min(index, size()));
+    return true;
+}
+
+bool OrderTree::erase(const std::string &id) {
+    auto it = index_.find(id);
+    if (it == index_.end()) {
+        return false;
+    }
+    int node = it->second;
+    index_.erase(it);
+    detach(node);
+    release(node);
+    return true;
+}
+
+bool OrderTree::move(const std::string &id, size_t index) {
+    auto it = index_.find(id);
+    if (it == index_.end()) {
+        return false;
+    }
+    int node = it->second;
+    detach(node);
+    attach(node, std::min(index, size()));
+    return true;
+}
+
+void OrderTree::assign(const std::vector<std::string> &ids) {
+    clear();
+    nodes_.reserve(ids.size());
+    index_.reserve(ids.size());
+    for (const auto &id: ids) {
+        if (contains(id)) {
+            continue;
+        }
+        int node = allocate(id);
+        index_.emplace(id, node);
+        root_ = merge(root_, node);
+        nodes_[root_].parent = NIL;
+    }
+}
+
+void OrderTree::clear() {
+    nodes_.clear();
+    free_.clear();
+    index_.clear();
+    root_ = NIL;
+}
+
+std::vector<std::string> OrderTree::to_vector() const {
+    std::vector<std::string> result;
+    result.reserve(size());
+    // 非递归中序遍历
+    std::vector<int> stack;
+    int node = root_;
+    while (node != NIL || !stack.empty()) {
+        while (node != NIL) {
+            stack.push_back(node);
+            node = nodes_[node].left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        result.push_back(nodes_[node].id);
+        node = nodes_[node].right;
+    }
+    return result;
+}
+
+void OrderTree::pull(int node) {
+    nodes_[node].size = size_of(nodes_[node].left) + size_of(nodes_[node].right) + 1;
+}
+
+std::pair<int, int> OrderTree::split(int node, size_t k) {
+    if (node == NIL) {
+        return {NIL, NIL};
+    }
+    size_t left_size = size_of(nodes_[node].left);
+    if (k <= left_size) {
+        auto [first, second] = split(nodes_[node].left, k);
+        nodes_[node].left = second;
+        set_parent(second, node);
+        set_parent(first, NIL);
+        pull(node);
+        return {first, node};
+    }
+    auto [first, second] = split(nodes_[node].right, k - left_size - 1);
+    nodes_[node].right = first;
+    set_parent(first, node);
+    set_parent(second, NIL);
+    pull(node);
+    return {node, second};
+}
+
+int OrderTree::merge(int left, int right) {
+    if (left == NIL) {
+        return right;
+    }
+    if (right == NIL) {
+        return left;
+    }
+    if (nodes_[left].priority > nodes_[right].priority) {
+        int merged = merge(nodes_[left].right, right);
+        nodes_[left].right = merged;
+        set_parent(merged, left);
+        pull(left);
+        return left;
+    }
+    int merged = merge(left, nodes_[right].left);
+    nodes_[right].left = merged;
+    set_parent(merged, right);
+    pull(right);
+    return right;
+}
+
+int OrderTree::allocate(const std::string &id) {
+    Node node{id, static_cast<uint32_t>(rng_()), NIL, NIL, NIL, 1};
+    if (!free_.empty()) {
+        int slot = free_.back();
+        free_.pop_back();
+        nodes_[slot] = std::move(node);
+        return slot;
+    }
+    nodes_.push_back(std::move(node));
+    return static_cast<int>(nodes_.size() - 1);
+}
+
+void OrderTree::release(int node) {
+    nodes_[node].id.clear();
+    free_.push_back(node);
+}
+
+void OrderTree::attach(int node, size_t position) {
+    auto [first, second] = split(root_, position);
+    root_ = merge(merge(first, node), second);
+    nodes_[root_].parent = NIL;
+}
+
+void OrderTree::detach(int node) {
+    size_t position = position_of(node);
+    auto [first, rest] = split(root_, position);
+    auto [self, second] = split(rest, 1);
+    root_ = merge(first, second);
+    set_parent(root_, NIL);
+    nodes_[self].left = nodes_[self].right = NIL;
+    nodes_[self].parent = NIL;
+    nodes_[self].size = 1;
+}
@@ -0,0 +1,94 @@
+// OrderTree.h
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 播放顺序：按位置索引的隐式 treap，附带 id → 节点的映射
+ *        节点记录父节点与子树大小，按位置取元素、按 id 求位置、在任意位置插入、删除、移动都是期望 O(log n)，
+ *        不再需要对整个顺序做线性查找或整体替换。id 必须唯一。节点存放在数组中并复用空闲槽位，不单独分配内存。
+ *        不是线程安全的，由 TaskManager 的锁保护。
+ */
+class OrderTree {
+public:
+    OrderTree() : rng_(std::random_device{}()) {}
+
+    [[nodiscard]] size_t size() const { return size_of(root_); }
+
+    [[nodiscard]] bool empty() const { return root_ == NIL; }
+
+    [[nodiscard]] bool contains(const std::string &id) const { return index_.count(id) != 0; }
+
+    // index 必须小于 size()
+    [[nodiscard]] const std::string &at(size_t index) const;
+
+    [[nodiscard]] std::optional<size_t> index_of(const std::string &id) const;
+
+    // 插入到 index 之前，index 超过 size() 时追加到末尾；id 已存在时返回 false
+    bool insert(size_t index, const std::string &id);
+
+    bool push_back(const std::string &id) { return insert(size(), id); }
+
+    bool erase(const std::string &id);
+
+    // 移动到删除自身之后的序列中的 index 处，index 超过末尾时移到末尾
+    bool move(const std::string &id, size_t index);
+
+    // 整体替换，ids 中的重复项只保留第一次出现
+    void assign(const std::vector<std::string> &ids);
+
+    void clear();
+
+    [[nodiscard]] std::vector<std::string> to_vector() const;
+
+private:
+    static constexpr int NIL = -1;
+
+    struct Node {
+        std::string id;
+        uint32_t priority;
+        int left;
+        int right;
+        int parent;
+        size_t size;
+    };
+
+    [[nodiscard]] size_t size_of(int node) const { return node == NIL ? 0 : nodes_[node].size; }
+
+    [[nodiscard]] size_t position_of(int node) const;
+
+    void pull(int node);
+
+    void set_parent(int child, int parent) {
+        if (child != NIL) {
+            nodes_[child].parent = parent;
+        }
+    }
+
+    // 前 k 个元素分到 first，其余分到 second
+    std::pair<int, int> split(int node, size_t k);
+
+    int merge(int left, int right);
+
+    int allocate(const std::string &id);
+
+    void release(int node);
+
+    // 把单个节点接到 position 处，节点必须已经脱离树
+    void attach(int node, size_t position);
+
+    // 把节点从树中摘下，节点本身保留
+    void detach(int node);
+
+    std::vector<Node> nodes_;
+    std::vector<int> free_;
+    std::unordered_map<std::string, int> index_;
+    int root_ = NIL;
+    std::mt19937 rng_;
+};
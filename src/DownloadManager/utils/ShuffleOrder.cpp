@@ -0,0 +1,105 @@
+#include "ShuffleOrder.h"
+#include <utility>
+
+ShuffleOrder::ShuffleOrder(uint64_t seed) : seed_(seed) {
+    restart();
+}
+
+void ShuffleOrder::reseed(uint64_t seed) {
+    seed_ = seed;
+    cycle_ = 0;
+    avoid_repeat_.reset();
+    restart();
+}
+
+ShuffleOrder::State ShuffleOrder::state() const {
+    State state;
+    state.seed = seed_;
+    state.cycle = cycle_;
+    state.played.assign(played_.begin(), played_.end());
+    state.history.assign(history_.begin(), history_.begin() + static_cast<long>(cursor_));
+    return state;
+}
+
+void ShuffleOrder::restore(const State &state) {
+    seed_ = state.seed;
+    cycle_ = state.cycle;
+    avoid_repeat_.reset();
+    // 本轮内已经抽取的位置无法还原，改为把已播放的任务全部跳过，剩余任务仍然只播一次
+    restart();
+    played_.insert(state.played.begin(), state.played.end());
+    size_t skip = state.history.size() > MAX_HISTORY ? state.history.size() - MAX_HISTORY : 0;
+    history_.assign(state.history.begin() + static_cast<long>(skip), state.history.end());
+    cursor_ = history_.size();
+}
+
+void ShuffleOrder::rebuild(const std::vector<std::string> &ids) {
+    pool_.clear();
+    members_.clear();
+    for (const auto &id: ids) {
+        add(id);
+    }
+    cycle_ = 0;
+    avoid_repeat_.reset();
+    history_.clear();
+    cursor_ = 0;
+    restart();
+}
+
+void ShuffleOrder::add(const std::string &id) {
+    if (members_.insert(id).second) {
+        pool_.push_back(id);
+    } else {
+        // 移除后又加回来的任务：本轮没播过的话仍可被抽到
+        played_.erase(id);
+    }
+}
+
+void ShuffleOrder::visit(const std::string &id) {
+    add(id);
+    played_.insert(id);
+    push_history(id);
+}
+
+size_t ShuffleOrder::draw() {
+    size_t remaining = pool_.size() - drawn_;
+    size_t position = drawn_ + static_cast<size_t>(rng_() % remaining);
+    size_t chosen = value_at(position);
+
+    if (avoid_repeat_ && remaining > 1 && pool_[chosen] == *avoid_repeat_) {
+        // 新一轮的第一首恰好是上一轮的最后一首，换成剩余区间中的另一个位置
+        size_t other = drawn_ + static_cast<size_t>(rng_() % (remaining - 1));
+        position = other >= position ? other + 1 : other;
+        chosen = value_at(position);
+    }
+    avoid_repeat_.reset();
+
+    swapped_[position] = value_at(drawn_);
+    swapped_[drawn_] = chosen;
+    drawn_++;
+    return chosen;
+}
+
+void ShuffleOrder::restart() {
+    // 每一轮的随机序列只由种子和轮次决定
+    std::seed_seq seq{static_cast<uint32_t>(seed_), static_cast<uint32_t>(seed_ >> 32),
+                      static_cast<uint32_t>(cycle_), static_cast<uint32_t>(cycle_ >> 32)};
+    rng_.seed(seq);
+    swapped_.clear();
+    drawn_ = 0;
+    played_.clear();
+}
+
+void ShuffleOrder::push_history(const std::string &id) {
+    if (cursor_ > 0 && history_[cursor_ - 1] == id) {
+        // 已经是当前任务（例如恢复后再切到随机模式），不重复记录
+        return;
+    }
+    // 从“上一首”回退的位置重新前进时，丢弃之后的历史
+    history_.resize(cursor_);
+    history_.push_back(id);
+    if (history_.size() > MAX_HISTORY) {
+        history_.erase(history_.begin(), history_.begin() + static_cast<long>(history_.size() - MAX_HISTORY / 2));
+    }
+    cursor_ = history_.size();
+}
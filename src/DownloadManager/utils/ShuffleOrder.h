@@ -0,0 +1,140 @@
+// ShuffleOrder.h
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * @brief 随机播放顺序：由种子决定的惰性 Fisher–Yates 洗牌
+ *        不预先生成整个排列，每前进一首只做一次交换，交换过的位置记在稀疏表里，前进是 O(1)。
+ *        新加入的任务直接追加到候选区间末尾，参与本轮剩余部分的抽取，不需要重新洗牌。
+ *        一轮内每个任务只播放一次，已移除的任务被抽到时跳过；一轮结束后以 种子 + 轮次 开始下一轮，
+ *        并保证新一轮的第一首不是上一轮的最后一首。同样的种子和操作序列得到同样的顺序。
+ *        不是线程安全的，由 TaskManager 的锁保护。
+ */
+class ShuffleOrder {
+public:
+    // 可保存的随机播放进度：种子、轮次、本轮已播放的任务与“上一首”历史
+    struct State {
+        uint64_t seed = 0;
+        uint64_t cycle = 0;
+        std::vector<std::string> played;
+        std::vector<std::string> history; // 截止到当前任务
+    };
+
+    explicit ShuffleOrder(uint64_t seed = std::random_device{}());
+
+    [[nodiscard]] uint64_t seed() const { return seed_; }
+
+    [[nodiscard]] uint64_t cycle() const { return cycle_; }
+
+    // 以新种子从头开始，候选任务不变
+    void reseed(uint64_t seed);
+
+    [[nodiscard]] State state() const;
+
+    // 回到保存时的轮次，本轮已播放的任务不会再被抽到；候选任务不变，需先 rebuild
+    void restore(const State &state);
+
+    // 整体替换候选任务并从头开始，种子不变
+    void rebuild(const std::vector<std::string> &ids);
+
+    void add(const std::string &id);
+
+    // 手动跳转到的任务计入本轮已播放，之后不会再被抽到
+    void visit(const std::string &id);
+
+    // 前进一首：先重放“上一首”之后的历史，再抽取新的任务；alive 判断任务是否仍在列表中
+    template<typename Alive>
+    std::optional<std::string> next(Alive &&alive) {
+        while (cursor_ < history_.size()) {
+            const std::string &id = history_[cursor_++];
+            if (alive(id)) {
+                return id;
+            }
+        }
+        size_t exhausted = 0;
+        while (true) {
+            if (drawn_ == pool_.size()) {
+                // 一整轮都没有可播放的任务
+                if (pool_.empty() || ++exhausted > 1) {
+                    return std::nullopt;
+                }
+                start_cycle(alive);
+                continue;
+            }
+            const std::string &id = pool_[draw()];
+            if (played_.count(id) != 0 || !alive(id)) {
+                continue;
+            }
+            exhausted = 0;
+            played_.insert(id);
+            push_history(id);
+            return id;
+        }
+    }
+
+    // 回到上一首，没有更早的历史时返回 nullopt
+    template<typename Alive>
+    std::optional<std::string> previous(Alive &&alive) {
+        while (cursor_ > 1) {
+            cursor_--;
+            const std::string &id = history_[cursor_ - 1];
+            if (alive(id)) {
+                return id;
+            }
+        }
+        return std::nullopt;
+    }
+
+private:
+    static constexpr size_t MAX_HISTORY = 1024;
+
+    // 在 [drawn_, n) 中随机选一个位置与 drawn_ 交换，返回换到 drawn_ 上的候选下标
+    size_t draw();
+
+    [[nodiscard]] size_t value_at(size_t position) const {
+        auto it = swapped_.find(position);
+        return it == swapped_.end() ? position : it->second;
+    }
+
+    void restart();
+
+    // 开始新一轮：清理已移除的候选并以 种子 + 轮次 重新播种
+    template<typename Alive>
+    void start_cycle(Alive &&alive) {
+        std::vector<std::string> live;
+        live.reserve(pool_.size());
+        for (auto &id: pool_) {
+            if (alive(id)) {
+                live.push_back(std::move(id));
+            }
+        }
+        pool_ = std::move(live);
+        members_ = std::unordered_set<std::string>(pool_.begin(), pool_.end());
+        cycle_++;
+        restart();
+        avoid_repeat_ = !history_.empty() ? std::optional<std::string>(history_.back()) : std::nullopt;
+    }
+
+    void push_history(const std::string &id);
+
+    uint64_t seed_;
+    uint64_t cycle_ = 0;
+    std::mt19937_64 rng_;
+
+    std::vector<std::string> pool_;                 // 候选任务，下标即洗牌前的位置
+    std::unordered_set<std::string> members_;       // pool_ 中已有的 id，避免重复追加
+    std::unordered_map<size_t, size_t> swapped_;    // 虚拟排列中被交换过的位置
+    size_t drawn_ = 0;                              // 本轮已抽取的位置数
+    std::unordered_set<std::string> played_;        // 本轮已播放（含手动跳转）的任务
+    std::optional<std::string> avoid_repeat_;       // 新一轮第一首需要避开的任务
+
+    std::vector<std::string> history_;              // 播放历史，供“上一首”使用
+    size_t cursor_ = 0;                             // history_[cursor_ - 1] 为当前任务
+};
@@ -0,0 +1,198 @@
+// SpscRing.h
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <coro/coro.hpp>
+
+/**
+ * @brief 单生产者单消费者无锁环形缓冲区
+ *        容量向上取整为 2 的幂；tail_ 只由生产者写，head_ 只由消费者写，双方只读取对方的索引。
+ *        write/read 为批量拷贝接口，只用于可平凡复制的元素（如 PCM 样本）；try_push/try_pop 用于需要移动语义的元素。
+ */
+template<typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+            : capacity_(round_up_pow2(capacity)), mask_(capacity_ - 1),
+              buffer_(std::make_unique<T[]>(capacity_)) {}
+
+    SpscRing(const SpscRing &) = delete;
+
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+
+    [[nodiscard]] size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] bool empty() const { return size() == 0; }
+
+    [[nodiscard]] size_t free_space() const { return capacity_ - size(); }
+
+    // 生产者调用
+    bool try_push(T &&value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == capacity_) {
+            return false;
+        }
+        buffer_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 消费者调用
+    std::optional<T> try_pop() {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T> value(std::move(buffer_[head & mask_]));
+        head_.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    // 生产者调用：尽量写入 count 个元素，返回实际写入数
+    size_t write(const T *data, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "write 只支持可平凡复制的元素");
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t n = std::min(count, capacity_ - (tail - head_.load(std::memory_order_acquire)));
+        size_t offset = tail & mask_;
+        size_t first = std::min(n, capacity_ - offset);
+        std::memcpy(buffer_.get() + offset, data, first * sizeof(T));
+        std::memcpy(buffer_.get(), data + first, (n - first) * sizeof(T));
+        tail_.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    // 消费者调用：尽量读出 count 个元素，返回实际读出数
+    size_t read(T *out, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "read 只支持可平凡复制的元素");
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t n = std::min(count, tail_.load(std::memory_order_acquire) - head);
+        size_t offset = head & mask_;
+        size_t first = std::min(n, capacity_ - offset);
+        std::memcpy(out, buffer_.get() + offset, first * sizeof(T));
+        std::memcpy(out + first, buffer_.get(), (n - first) * sizeof(T));
+        head_.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // 消费者调用：丢弃当前所有元素
+    void clear() {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            head_.store(tail_.load(std::memory_order_acquire), std::memory_order_release);
+        } else {
+            while (try_pop()) {}
+        }
+    }
+
+private:
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    std::unique_ptr<T[]> buffer_;
+
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/**
+ * @brief 带协程等待的 SPSC 环形缓冲区
+ *        生产者在缓冲区满时等待 space_event_，消费者在缓冲区空时等待 data_event_。
+ *        等待顺序固定为 reset → 复查 → co_await，不会错过对端的 set；被唤醒后切回调用方传入的执行器，
+ *        不在对端线程上继续执行。close 后所有等待立即返回。
+ */
+template<typename T>
+class AsyncSpscRing : public SpscRing<T> {
+public:
+    using SpscRing<T>::SpscRing;
+
+    // 等待至少 min_count 个元素或一次数据通知；返回 false 表示已关闭且数据不足
+    template<typename Executor>
+    coro::task<bool> wait_for_data(Executor &executor, size_t min_count = 1) {
+        data_event_.reset();
+        if (this->size() < min_count && !closed_.load(std::memory_order_acquire)) {
+            co_await data_event_;
+            co_await executor.schedule();
+        }
+        co_return this->size() >= min_count || !closed_.load(std::memory_order_acquire);
+    }
+
+    // 同上，另外在 ready() 为真时也不等待，用于同时等待另一个缓冲区（对端写入后需调用本缓冲区的 notify_data）
+    template<typename Executor, typename Ready>
+    coro::task<bool> wait_for_data(Executor &executor, size_t min_count, Ready ready) {
+        data_event_.reset();
+        if (this->size() < min_count && !ready() && !closed_.load(std::memory_order_acquire)) {
+            co_await data_event_;
+            co_await executor.schedule();
+        }
+        co_return this->size() >= min_count || !closed_.load(std::memory_order_acquire);
+    }
+
+    // 等待至少 min_free 个空位或一次空间通知；返回 false 表示已关闭
+    template<typename Executor>
+    coro::task<bool> wait_for_space(Executor &executor, size_t min_free = 1) {
+        space_event_.reset();
+        if (this->free_space() < min_free && !closed_.load(std::memory_order_acquire)) {
+            co_await space_event_;
+            co_await executor.schedule();
+        }
+        co_return !closed_.load(std::memory_order_acquire);
+    }
+
+    template<typename Executor>
+    coro::task<bool> push(Executor &executor, T value) {
+        while (!this->try_push(std::move(value))) {
+            if (!co_await wait_for_space(executor)) {
+                co_return false;
+            }
+        }
+        notify_data();
+        co_return true;
+    }
+
+    template<typename Executor>
+    coro::task<std::optional<T>> pop(Executor &executor) {
+        while (true) {
+            if (auto value = this->try_pop()) {
+                notify_space();
+                co_return value;
+            }
+            if (closed_.load(std::memory_order_acquire)) {
+                co_return std::nullopt;
+            }
+            co_await wait_for_data(executor);
+        }
+    }
+
+    void notify_data() { data_event_.set(); }
+
+    void notify_space() { space_event_.set(); }
+
+    void close() {
+        closed_.store(true, std::memory_order_release);
+        data_event_.set();
+        space_event_.set();
+    }
+
+    [[nodiscard]] bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+private:
+    coro::event data_event_;
+    coro::event space_event_;
+    std::atomic<bool> closed_{false};
+};
@@ -59,7 +59,7 @@ std::shared_ptr<uvgrtp::media_stream> RTPInstance::createStream(const std::strin
     stream->configure_ctx(RCC_SSRC, streamInfo.audio_ssrc);
     stream->configure_ctx(RCC_DYN_PAYLOAD_TYPE, streamInfo.audio_pt);
     stream->configure_ctx(RCC_CLOCK_RATE, 48000);
-    stream->configure_ctx(RCC_MTU_SIZE, 1408); // KOOK 只支持到 1500
+    stream->configure_ctx(RCC_MTU_SIZE, RTP_MTU_SIZE);
 
     if (!main_stream_) {
         main_stream_ = stream;
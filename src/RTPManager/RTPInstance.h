@@ -10,6 +10,9 @@
 #include <uvgrtp/session.hh>
 #include <uvgrtp/media_stream.hh>
 
+constexpr int RTP_MTU_SIZE = 1408;   // KOOK 只支持到 1500
+constexpr int RTP_HEADER_SIZE = 12;  // 不带 CSRC 与扩展头的 RTP 固定头
+
 struct ChannelJoinedData {
     std::string ip;
     int port;
@@ -18,6 +21,8 @@ struct ChannelJoinedData {
     int audio_pt;
     int bitrate;
     bool rtcp_mux;
+    int frame_duration = 0; // Opus 帧时长（毫秒），0 表示默认值
+    int frames_per_packet = 0; // 每个 RTP 包合并的 Opus 帧数，0 表示不合并
 };
 
 class RTPInstance {
@@ -1,6 +1,8 @@
 #include "EventPublisher.h"
 #include "handlers/Handlers.h"
-#include <thread>
+#include "StatusAggregator.h"
+#include "../ConfigManager.h"
+#include <algorithm>
 #include <chrono>
 
 EventPublisher &EventPublisher::getInstance() {
@@ -12,10 +14,14 @@ EventPublisher::EventPublisher()
         : context_(1),
           publisher_(context_, zmq::socket_type::pub),
           router(context_, zmq::socket_type::router),
+          outbox_receiver_(context_, zmq::socket_type::pair),
+          outbox_sender_(context_, zmq::socket_type::pair),
+          wakeup_receiver_(context_, zmq::socket_type::pair),
+          wakeup_sender_(context_, zmq::socket_type::pair),
           publisher_bind_address_("tcp://*:5556"),
           responder_bind_address_("tcp://*:5557"),
           initialized_(false) {
-    Handlers::getInstance();
+    strands_ = std::make_unique<StreamStrands>(Handlers::getInstance().tp);
     initialize();
 }
 
@@ -23,13 +29,18 @@ EventPublisher::~EventPublisher() {
     if (initialized_) {
         publisher_.close();
         router.close();
+        outbox_sender_.close();
+        outbox_receiver_.close();
+        wakeup_sender_.close();
+        wakeup_receiver_.close();
     }
 }
 
 void EventPublisher::publish_event(const std::string &event_message) {
     try {
-        zmq::message_t event(event_message.data(), event_message.size());
-        auto result = router.send(event, zmq::send_flags::dontwait);
+        std::vector<zmq::message_t> frames;
+        frames.emplace_back(event_message.data(), event_message.size());
+        auto result = send_outbound(frames);
 
         if (result) {
             LOG(INFO) << "Published: " << event_message;
@@ -45,17 +56,11 @@ void EventPublisher::publish_event(const std::string &event_message) {
 
 void EventPublisher::publish_event(const OMNI::Response &response) {
     try {
-        size_t size = response.ByteSizeLong();
-        std::vector<uint8_t> serialized_data(size);
-        response.SerializeToArray(serialized_data.data(), size);
-
         std::string routing_id = "OMNI"; // 固定 routingId
-        zmq::message_t client_identity(routing_id.begin(), routing_id.end());
-        zmq::message_t empty_frame;
-        zmq::message_t message_to_send(serialized_data.data(), serialized_data.size());
-        router.send(client_identity, zmq::send_flags::sndmore);
-        // router.send(empty_frame, zmq::send_flags::sndmore);
-        auto result = router.send(message_to_send, zmq::send_flags::dontwait);
+        std::vector<zmq::message_t> frames;
+        frames.emplace_back(routing_id.begin(), routing_id.end());
+        frames.push_back(serialize_response(response));
+        auto result = send_outbound(frames);
         if (!result) {
             LOG(WARNING) << "Failed to publish event (message queue may be full)";
         }
@@ -69,10 +74,9 @@ void EventPublisher::publish_event(const OMNI::Response &response) {
 void EventPublisher::initialize() {
     if (!initialized_) {
         try {
-            // initialize_publisher();
+            initialize_publisher();
             initialize_responder();
-
-            std::this_thread::sleep_for(std::chrono::seconds(2));
+            initialize_outbox();
             initialized_ = true;
 
         } catch (const zmq::error_t &e) {
@@ -100,4 +104,164 @@ void EventPublisher::initialize_responder() {
         LOG(ERROR) << "Failed to bind responder: " << e.what();
         throw;
     }
-}
\ No newline at end of file
+}
+void EventPublisher::initialize_outbox() {
+    try {
+        // 响应也经 outbox 发出，批量请求时可能瞬间积压上千条，不设高水位
+        outbox_sender_.set(zmq::sockopt::sndhwm, 0);
+        outbox_receiver_.set(zmq::sockopt::rcvhwm, 0);
+        // inproc 先 bind 再 connect
+        outbox_receiver_.bind(OUTBOX_ADDRESS);
+        outbox_sender_.connect(OUTBOX_ADDRESS);
+        wakeup_receiver_.bind(WAKEUP_ADDRESS);
+        wakeup_sender_.connect(WAKEUP_ADDRESS);
+    } catch (const zmq::error_t &e) {
+        LOG(ERROR) << "Failed to set up outbox: " << e.what();
+        throw;
+    }
+}
+
+bool EventPublisher::send_outbound(std::vector<zmq::message_t> &frames) {
+    std::lock_guard<std::mutex> lock(outbox_mutex_);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        auto flags = i + 1 < frames.size() ? zmq::send_flags::sndmore : zmq::send_flags::dontwait;
+        if (!outbox_sender_.send(frames[i], flags)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void EventPublisher::forward_outbound() {
+    try {
+        zmq::message_t frame;
+        while (outbox_receiver_.recv(frame, zmq::recv_flags::dontwait)) {
+            // 逐帧转发，保留多帧消息的边界；后续帧已经在 PAIR 中就绪，不会阻塞
+            while (frame.more()) {
+                router.send(frame, zmq::send_flags::sndmore);
+                (void) outbox_receiver_.recv(frame, zmq::recv_flags::none);
+            }
+            if (!router.send(frame, zmq::send_flags::dontwait)) {
+                LOG(WARNING) << "Failed to publish event (message queue may be full)";
+            }
+        }
+    } catch (const zmq::error_t &e) {
+        LOG(ERROR) << "ZMQ Error: " << e.what();
+    }
+}
+
+void EventPublisher::notify_status() {
+    try {
+        std::lock_guard<std::mutex> lock(wakeup_mutex_);
+        // 反应器还没取走上一次唤醒时发送会失败，忽略即可
+        (void) wakeup_sender_.send(zmq::message_t(), zmq::send_flags::dontwait);
+    } catch (const zmq::error_t &e) {
+        LOG(ERROR) << "ZMQ Error: " << e.what();
+    }
+}
+
+void EventPublisher::flush_status() {
+    strands_->post(STATUS_STRAND_KEY, [this] { publish_status(); });
+}
+
+void EventPublisher::publish_status() {
+    OMNI::Response res = Handlers::get_res("", "");
+    if (!StatusAggregator::getInstance().collect(*res.mutable_status_delta())) {
+        return;
+    }
+    res.set_timestamp(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+
+    try {
+        std::string routing_id = "OMNI"; // 固定 routingId
+        std::vector<zmq::message_t> frames;
+        frames.emplace_back(routing_id.begin(), routing_id.end());
+        frames.push_back(serialize_response(res));
+        if (!send_outbound(frames)) {
+            LOG(WARNING) << "Failed to publish status (message queue may be full)";
+        }
+
+        // PUB 按首帧前缀过滤，每个流单独一条，订阅方可以只订阅关心的 stream_id 前缀
+        const auto &delta = res.status_delta();
+        auto publish = [this](const std::string &stream_id, OMNI::Response &single) {
+            single.set_stream_id(stream_id);
+            zmq::message_t body = serialize_response(single);
+            publisher_.send(zmq::message_t(stream_id.begin(), stream_id.end()), zmq::send_flags::sndmore);
+            publisher_.send(body, zmq::send_flags::dontwait);
+        };
+        for (const auto &stream: delta.streams()) {
+            OMNI::Response single;
+            single.set_timestamp(res.timestamp());
+            *single.mutable_status_delta()->add_streams() = stream;
+            publish(stream.stream_id(), single);
+        }
+        for (const auto &play_list: delta.play_lists()) {
+            OMNI::Response single;
+            single.set_timestamp(res.timestamp());
+            *single.mutable_status_delta()->add_play_lists() = play_list;
+            publish(play_list.stream_id(), single);
+        }
+        for (const auto &stream_id: delta.removed_stream_ids()) {
+            OMNI::Response single;
+            single.set_timestamp(res.timestamp());
+            single.set_code(OMNI::NOT_FOUND);
+            single.mutable_status_delta()->add_removed_stream_ids(stream_id);
+            publish(stream_id, single);
+        }
+    } catch (const zmq::error_t &e) {
+        LOG(ERROR) << "ZMQ Error: " << e.what();
+    }
+}
+
+void EventPublisher::run() {
+    running_ = true;
+    const auto status_interval = std::chrono::milliseconds(
+            std::max(0, ConfigManager::getInstance().getConfig().status_interval_ms));
+    zmq::pollitem_t items[] = {
+            {router.handle(), 0, ZMQ_POLLIN, 0},
+            {outbox_receiver_.handle(), 0, ZMQ_POLLIN, 0},
+            {wakeup_receiver_.handle(), 0, ZMQ_POLLIN, 0},
+    };
+
+    while (running_) {
+        // 有聚合周期在进行时只睡到周期结束
+        auto timeout = std::chrono::milliseconds(POLL_TIMEOUT_MS);
+        if (status_deadline_) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    *status_deadline_ - std::chrono::steady_clock::now());
+            timeout = std::clamp(remaining, std::chrono::milliseconds(0), timeout);
+        }
+
+        try {
+            zmq::poll(items, 3, timeout);
+        } catch (const zmq::error_t &e) {
+            if (e.num() == ETERM) {
+                break;
+            }
+            LOG(ERROR) << "ZMQ poll error: " << e.what();
+            continue;
+        }
+
+        if (items[2].revents & ZMQ_POLLIN) {
+            zmq::message_t wakeup;
+            while (wakeup_receiver_.recv(wakeup, zmq::recv_flags::dontwait)) {}
+            if (!status_deadline_) {
+                status_deadline_ = std::chrono::steady_clock::now() + status_interval;
+            }
+        }
+        if (items[0].revents & ZMQ_POLLIN) {
+            while (handle_request_response()) {}
+        }
+        // 请求处理过程中产生的事件也在这里一并发出
+        forward_outbound();
+
+        if (status_deadline_ && std::chrono::steady_clock::now() >= *status_deadline_) {
+            status_deadline_.reset();
+            flush_status();
+        }
+    }
+}
+
+void EventPublisher::stop() {
+    running_ = false;
+}
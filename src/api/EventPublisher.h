@@ -2,8 +2,16 @@
 #define EVENTPUBLISHER_H
 
 #include <zmq.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
+#include "Request.pb.h"
 #include "Response.pb.h"
+#include "StreamStrands.h"
 
 class EventPublisher {
 public:
@@ -13,9 +21,13 @@ public:
 
     void publish_event(const OMNI::Response &response);
 
-    void handle_request_response();
+    // 任意线程调用：有流状态变脏，唤醒反应器开始一个聚合周期
+    void notify_status();
 
-    void handle_event_publish(const std::string &stream_id, bool isPlayList);
+    // 反应器循环：阻塞在 zmq::poll 上等待请求或待发事件，由主线程调用直到 stop。ROUTER 只在这个线程上收发
+    void run();
+
+    void stop();
 
 private:
     EventPublisher();
@@ -32,9 +44,54 @@ private:
 
     void initialize_responder();
 
+    void initialize_outbox();
+
+    // 接收一条请求并投递到线程池，没有待处理的请求时返回 false
+    bool handle_request_response();
+
+    // 执行单条 StreamRequest，结果写入 res；在该流的 strand 上调用
+    void dispatch_request(OMNI::Request &req, OMNI::Response &res);
+
+    // 把 BatchRequest 的各条目分别投递到对应流的 strand，全部完成后按原顺序回复整批，并记录整批耗时
+    void dispatch_batch(std::string identity, std::shared_ptr<OMNI::Request> req);
+
+    // 任意线程调用：经 outbox 把响应发回请求方
+    void send_response(const std::string &identity, const OMNI::Response &res);
+
+    static zmq::message_t serialize_response(const OMNI::Response &response);
+
+    // 把其他线程经 outbox 投递的消息原样转发到 ROUTER
+    void forward_outbound();
+
+    // 任意线程调用：把一条多帧消息投递到 outbox
+    bool send_outbound(std::vector<zmq::message_t> &frames);
+
+    // 聚合周期到期：只在反应器线程调用，把增量的组装与发送投递到状态 strand，反应器不执行任何流的查询
+    void flush_status();
+
+    // 在状态 strand 上执行：整批增量经 outbox 发给 ROUTER 上的 OMNI，并按流拆分以 stream_id 为主题发到 PUB
+    void publish_status();
+
+    static constexpr int POLL_TIMEOUT_MS = 1000; // 超时只用于检查 stop
+    static constexpr const char *OUTBOX_ADDRESS = "inproc://event-publisher-outbox";
+    static constexpr const char *WAKEUP_ADDRESS = "inproc://event-publisher-wakeup";
+    static constexpr const char *FLEET_STRAND_KEY = "\x01fleet"; // GetAllStreams、GetMetrics 专用的 strand，不会与真实的 stream_id 冲突
+    static constexpr const char *STATUS_STRAND_KEY = "\x01status"; // 状态增量专用的 strand，各周期按顺序发出
+
     zmq::context_t context_;
-    zmq::socket_t publisher_;
+    zmq::socket_t publisher_; // 初始化后只在状态 strand 上使用，strand 串行执行，同一时刻只有一个线程访问
     zmq::socket_t router;
+    // 出站事件：各线程经 outbox_sender_ 投递（PAIR 不是线程安全的，用 outbox_mutex_ 串行化），反应器从 outbox_receiver_ 取出后写 ROUTER
+    zmq::socket_t outbox_receiver_;
+    zmq::socket_t outbox_sender_;
+    std::mutex outbox_mutex_;
+    // 状态唤醒：空消息只用于打断 poll，真正的状态在 StatusAggregator 中
+    zmq::socket_t wakeup_receiver_;
+    zmq::socket_t wakeup_sender_;
+    std::mutex wakeup_mutex_;
+    std::optional<std::chrono::steady_clock::time_point> status_deadline_; // 只由反应器线程访问
+    std::atomic<bool> running_{false};
+    std::unique_ptr<StreamStrands> strands_; // 请求处理在线程池上按流串行执行，反应器线程只负责收发
     std::string publisher_bind_address_;
     std::string responder_bind_address_;
     bool initialized_;
@@ -4,32 +4,44 @@
 #include <google/protobuf/util/time_util.h>
 
 #include "handlers/Handlers.h"
+#include "StatusAggregator.h"
 
 using namespace OMNI::Instance;
 
-// 处理请求/响应逻辑
-void EventPublisher::handle_request_response() {
-    try {
-        zmq::message_t identity;
-        zmq::message_t request;
-        auto result_identity = router.recv(identity, zmq::recv_flags::dontwait);
-        if (!result_identity) {
-            return;
-        }
+namespace {
+    int64_t now_milliseconds() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
 
-        auto result_request = router.recv(request, zmq::recv_flags::none);
-        if (!result_request) {
-            return;
+    // 处理函数抛出异常时也要填好错误响应：批量请求要靠每个条目完成才会回复，单条请求的调用方也在等回复
+    template<typename Fn>
+    void guard_handler(OMNI::Response &res, Fn &&fn) {
+        try {
+            fn();
+        } catch (const std::exception &e) {
+            LOG(ERROR) << "[EventPublisher] 处理请求时出错: " << e.what();
+            res.set_code(OMNI::ERROR);
+            res.set_message(std::string("处理请求时出错: ") + e.what());
+        } catch (...) {
+            LOG(ERROR) << "[EventPublisher] 处理请求时出现未知异常";
+            res.set_code(OMNI::ERROR);
+            res.set_message("处理请求时出现未知异常。");
         }
+    }
+}
 
-        OMNI::Request req;
-        req.ParsePartialFromArray(request.data(), request.size());
+zmq::message_t EventPublisher::serialize_response(const OMNI::Response &response) {
+    // 直接序列化进 zmq 消息的缓冲区，省掉中间的 vector 和一次拷贝
+    size_t size = response.ByteSizeLong();
+    zmq::message_t message(size);
+    response.SerializeWithCachedSizesToArray(static_cast<uint8_t *>(message.data()));
+    return message;
+}
 
-        if (!req.has_stream_request()) {
-            return;
-        }
+void EventPublisher::dispatch_request(OMNI::Request &req, OMNI::Response &res) {
+    guard_handler(res, [&req, &res] {
         auto message = req.mutable_stream_request();
-        auto res = Handlers::get_res(req.id(), message->info().stream_id());
         Handlers &handlers = Handlers::getInstance();
         switch (message->payload_case()) {
             case StreamRequest::kStartStreamPayload:
@@ -40,7 +52,7 @@ void EventPublisher::handle_request_response() {
                 break;
             case StreamRequest::kUpdateStreamPayload:
                 handlers.updateStreamHandler(message->mutable_update_stream_payload(), res);
-                handle_event_publish(res.stream_id(), false);
+                StatusAggregator::getInstance().mark_dirty(res.stream_id());
                 break;
             case StreamRequest::kGetStreamPayload:
                 handlers.getStreamHandler(message->mutable_get_stream_payload(), res);
@@ -51,50 +63,142 @@ void EventPublisher::handle_request_response() {
             case StreamRequest::kUpdatePlayListPayload:
                 handlers.updatePlayListHandler(message->mutable_update_play_list_payload(), res);
                 break;
+            case StreamRequest::kPatchPlayListPayload:
+                handlers.patchPlayListHandler(message->mutable_patch_play_list_payload(), res);
+                break;
             default:
                 res.set_code(OMNI::ERROR);
                 res.set_message("Unknown request type.");
         }
+    });
+    res.set_timestamp(now_milliseconds());
+}
 
-        auto now = std::chrono::system_clock::now();
-        int64_t milliseconds_since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now.time_since_epoch()).count();
-        res.set_timestamp(milliseconds_since_epoch);
-
-        size_t size = res.ByteSizeLong();
-        std::vector<uint8_t> serialized_data(size);
-        res.SerializeToArray(serialized_data.data(), size);
-
-        zmq::message_t empty_frame;
-        zmq::message_t messageToSend(serialized_data.data(), serialized_data.size());
-
-        router.send(identity, zmq::send_flags::sndmore);
-        // router.send(empty_frame, zmq::send_flags::sndmore);
-        router.send(messageToSend, zmq::send_flags::none);
+void EventPublisher::send_response(const std::string &identity, const OMNI::Response &res) {
+    try {
+        std::vector<zmq::message_t> frames;
+        frames.emplace_back(identity.data(), identity.size());
+        frames.push_back(serialize_response(res));
+        if (!send_outbound(frames)) {
+            LOG(WARNING) << "Failed to send response (message queue may be full)";
+        }
     } catch (const zmq::error_t &e) {
         LOG(ERROR) << "ZMQ Error: " << e.what();
-    } catch (const std::exception &e) {
-        LOG(ERROR) << "Standard Error: " << e.what();
     }
 }
 
-void EventPublisher::handle_event_publish(const std::string &stream_id, bool isPlayList) {
-    OMNI::Request req;
-    auto res = Handlers::get_res("", stream_id);
-    Handlers &handlers = Handlers::getInstance();
+void EventPublisher::dispatch_batch(std::string identity, std::shared_ptr<OMNI::Request> req) {
+    // 各条目投递到各自流的 strand 上并行执行，最后一个完成的条目负责回复整批
+    struct BatchState {
+        std::string identity;
+        std::shared_ptr<OMNI::Request> req;
+        OMNI::Response res;
+        std::vector<OMNI::Response *> responses;
+        std::chrono::steady_clock::time_point started;
+        std::atomic<int> remaining{1}; // 多持有一份，投递完所有条目后才释放
+    };
+    auto state = std::make_shared<BatchState>();
+    state->identity = std::move(identity);
+    state->req = std::move(req);
+    state->res = Handlers::get_res(state->req->id(), "");
+    state->started = std::chrono::steady_clock::now();
+
+    auto finish = [this](BatchState &batch) {
+        auto latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - batch.started).count();
+        batch.res.mutable_batch_response()->set_latency_us(latency);
+        batch.res.set_timestamp(now_milliseconds());
+        VLOG(1) << "[EventPublisher] 批量请求 " << batch.responses.size() << " 条，耗时 " << latency << "us";
+        send_response(batch.identity, batch.res);
+    };
 
-    if (isPlayList) {
-        auto payload = req.mutable_stream_request()->mutable_get_play_list_payload();
-        handlers.getPlayListHandler(payload, res);
-    } else {
-        auto payload = req.mutable_stream_request()->mutable_get_stream_payload();
-        handlers.getStreamHandler(payload, res);
+    // 先在反应器线程上分配好所有响应，之后各 strand 只写自己那一条
+    auto batch = state->req->mutable_batch_request();
+    auto responses = state->res.mutable_batch_response()->mutable_responses();
+    responses->Reserve(batch->requests_size());
+    for (auto &entry: *batch->mutable_requests()) {
+        auto *entry_res = responses->Add();
+        if (!entry.has_stream_request()) {
+            *entry_res = Handlers::get_res(entry.id(), "");
+            entry_res->set_code(OMNI::INVALID_REQUEST);
+            entry_res->set_message(entry.has_batch_request() ? "不支持嵌套的批量请求。" : "缺少请求内容。");
+            entry_res->set_timestamp(now_milliseconds());
+            state->responses.push_back(nullptr);
+            continue;
+        }
+        *entry_res = Handlers::get_res(entry.id(), entry.stream_request().info().stream_id());
+        state->responses.push_back(entry_res);
+    }
+
+    for (size_t i = 0; i < state->responses.size(); ++i) {
+        if (!state->responses[i]) {
+            continue;
+        }
+        state->remaining.fetch_add(1, std::memory_order_relaxed);
+        auto &entry = *batch->mutable_requests(static_cast<int>(i));
+        strands_->post(entry.stream_request().info().stream_id(), [this, state, &entry, i, finish] {
+            dispatch_request(entry, *state->responses[i]);
+            if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                finish(*state);
+            }
+        });
+    }
+    if (state->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finish(*state);
     }
+}
 
-    auto now = std::chrono::system_clock::now();
-    int64_t milliseconds_since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(
-            now.time_since_epoch()).count();
-    res.set_timestamp(milliseconds_since_epoch);
+// 接收请求并投递到对应流的 strand，只在反应器线程上调用；响应在处理完成后经 outbox 发回，由 Request.id 关联
+bool EventPublisher::handle_request_response() {
+    try {
+        zmq::message_t identity;
+        zmq::message_t request;
+        auto result_identity = router.recv(identity, zmq::recv_flags::dontwait);
+        if (!result_identity) {
+            return false;
+        }
 
-    publish_event(res);
+        auto result_request = router.recv(request, zmq::recv_flags::none);
+        if (!result_request) {
+            return true;
+        }
+
+        auto req = std::make_shared<OMNI::Request>();
+        req->ParsePartialFromArray(request.data(), request.size());
+
+        if (req->has_stream_request()) {
+            auto stream_id = req->stream_request().info().stream_id();
+            strands_->post(stream_id, [this, identity = identity.to_string(), req] {
+                auto res = Handlers::get_res(req->id(), req->stream_request().info().stream_id());
+                dispatch_request(*req, res);
+                send_response(identity, res);
+            });
+        } else if (req->has_batch_request()) {
+            dispatch_batch(identity.to_string(), std::move(req));
+        } else if (req->has_get_all_streams()) {
+            // 只读各流的原子统计，不占用任何流的 strand
+            strands_->post(FLEET_STRAND_KEY, [this, identity = identity.to_string(), req] {
+                auto res = Handlers::get_res(req->id(), "");
+                guard_handler(res, [&req, &res] {
+                    Handlers::getInstance().getAllStreamsHandler(&req->get_all_streams(), res);
+                });
+                res.set_timestamp(now_milliseconds());
+                send_response(identity, res);
+            });
+        } else if (req->has_get_metrics()) {
+            strands_->post(FLEET_STRAND_KEY, [this, identity = identity.to_string(), req] {
+                auto res = Handlers::get_res(req->id(), "");
+                guard_handler(res, [&req, &res] {
+                    Handlers::getInstance().getMetricsHandler(&req->get_metrics(), res);
+                });
+                res.set_timestamp(now_milliseconds());
+                send_response(identity, res);
+            });
+        }
+    } catch (const zmq::error_t &e) {
+        LOG(ERROR) << "ZMQ Error: " << e.what();
+    } catch (const std::exception &e) {
+        LOG(ERROR) << "Standard Error: " << e.what();
+    }
+    return true;
 }
@@ -0,0 +1,202 @@
+#include "SnapshotManager.h"
+#include "StreamRegistry.h"
+#include "handlers/Handlers.h"
+#include "../ConfigManager.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <glog/logging.h>
+
+namespace {
+    int64_t now_milliseconds() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+}
+
+void SnapshotManager::remember(const std::string &stream_id, const OMNI::Instance::StartStreamPayload &payload) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // 流已经重新运行，快照中的旧记录由它的实时状态取代
+    carried_.erase(stream_id);
+    auto &saved = payloads_[stream_id];
+    saved = payload;
+    // 播放列表在保存快照时按当时的顺序重新填写
+    saved.clear_order_list();
+}
+
+void SnapshotManager::forget(const std::string &stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    payloads_.erase(stream_id);
+}
+
+bool SnapshotManager::discard(const std::string &stream_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return carried_.erase(stream_id) > 0;
+}
+
+size_t SnapshotManager::load() {
+    const std::string &path = ConfigManager::getInstance().getConfig().snapshot_path;
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        VLOG(1) << "[SnapshotManager] 没有快照文件 " << path;
+        return 0;
+    }
+    OMNI::Snapshot::NodeSnapshot node;
+    if (!node.ParseFromIstream(&in)) {
+        // 改名留存，之后的保存不会覆盖它
+        in.close();
+        std::error_code ec;
+        std::filesystem::rename(path, path + ".corrupt", ec);
+        LOG(ERROR) << "[SnapshotManager] 快照文件损坏，已另存为 " << path << ".corrupt";
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &stream: *node.mutable_streams()) {
+        if (stream.saved_at() == 0) {
+            // 旧格式的记录没有单独的采集时间，使用整个快照的时间
+            stream.set_saved_at(node.timestamp());
+        }
+        carried_[stream.stream_id()] = std::move(stream);
+    }
+    LOG(INFO) << "[SnapshotManager] 读取快照 " << path << "，共 " << carried_.size() << " 条流";
+    return carried_.size();
+}
+
+bool SnapshotManager::save() {
+    OMNI::Snapshot::NodeSnapshot node;
+    const int64_t now = now_milliseconds();
+    node.set_timestamp(now);
+
+    StreamRegistry::getInstance().forEach([this, &node, now](const std::string &,
+                                                             const std::shared_ptr<DownloadManager> &manager) {
+        auto sender = manager->get_audio_sender();
+        const std::string &stream_id = sender->stream_id_;
+        OMNI::Snapshot::StreamSnapshot *stream;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = payloads_.find(stream_id);
+            if (it == payloads_.end()) {
+                // 不是经 StartStream 创建的流，没有可用的启动参数
+                return;
+            }
+            stream = node.add_streams();
+            *stream->mutable_start() = it->second;
+        }
+        stream->set_stream_id(stream_id);
+        stream->set_saved_at(now);
+
+        auto *orders = stream->mutable_start()->mutable_order_list();
+        for (const auto &task: manager->getTasksInOrder()) {
+            auto *order = orders->Add();
+            order->set_task_id(task.name);
+            order->set_url(task.url);
+            order->set_type(Handlers::Task2OrderType(task.type));
+            order->set_use_stream(task.use_stream);
+        }
+        if (auto current = manager->getNextTask()) {
+            stream->set_current_task_id(current->name);
+        }
+        stream->set_play_mode(static_cast<OMNI::ConsumerMode>(manager->getMode()));
+        auto shuffle = manager->getShuffleState();
+        stream->set_shuffle_seed(shuffle.seed);
+        stream->set_shuffle_cycle(shuffle.cycle);
+        stream->mutable_shuffle_played()->Add(shuffle.played.begin(), shuffle.played.end());
+        stream->mutable_shuffle_history()->Add(shuffle.history.begin(), shuffle.history.end());
+
+        const auto &stats = sender->stats();
+        stream->set_time_played(stats.time_played_ms.load(std::memory_order_relaxed));
+        stream->set_volume(stats.volume.load(std::memory_order_relaxed));
+        stream->set_play_state(static_cast<OMNI::PlayState>(stats.play_state.load(std::memory_order_relaxed)));
+        stream->set_rtp_timestamp(stats.rtp_timestamp.load(std::memory_order_relaxed));
+    });
+
+    {
+        // 尚未恢复的记录原样带上，直到恢复成功或被显式移除
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &[stream_id, stream]: carried_) {
+            *node.add_streams() = stream;
+        }
+    }
+
+    const std::string &path = ConfigManager::getInstance().getConfig().snapshot_path;
+    const std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out || !node.SerializeToOstream(&out)) {
+            LOG(ERROR) << "[SnapshotManager] 写入快照失败: " << temp_path;
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec) {
+        LOG(ERROR) << "[SnapshotManager] 替换快照失败: " << ec.message();
+        return false;
+    }
+    VLOG(2) << "[SnapshotManager] 已保存 " << node.streams_size() << " 条流的快照";
+    return true;
+}
+
+coro::task<void> SnapshotManager::run(std::shared_ptr<coro::io_scheduler> scheduler, std::chrono::seconds interval) {
+    co_await scheduler->schedule();
+    while (true) {
+        co_await scheduler->yield_for(interval);
+        save();
+    }
+}
+
+coro::task<size_t> SnapshotManager::restore(std::shared_ptr<coro::thread_pool> tp, size_t concurrency) {
+    std::vector<OMNI::Snapshot::StreamSnapshot> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending.reserve(carried_.size());
+        for (const auto &[stream_id, stream]: carried_) {
+            pending.push_back(stream);
+        }
+    }
+    if (pending.empty()) {
+        co_return 0;
+    }
+
+    const size_t total = pending.size();
+    const size_t workers_count = std::max<size_t>(1, std::min(concurrency, total));
+    LOG(INFO) << "[SnapshotManager] 开始恢复 " << total << " 条流，并发 " << workers_count;
+
+    auto started = std::chrono::steady_clock::now();
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> restored{0};
+    std::vector<coro::task<void>> workers;
+    workers.reserve(workers_count);
+    for (size_t i = 0; i < workers_count; ++i) {
+        workers.push_back(restore_worker(tp, pending, next, restored));
+    }
+    co_await coro::when_all(std::move(workers));
+
+    auto cost = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    LOG(INFO) << "[SnapshotManager] 恢复完成 " << restored.load() << "/" << total << "，耗时 " << cost.count() << "ms";
+    co_return restored.load();
+}
+
+coro::task<void> SnapshotManager::restore_worker(std::shared_ptr<coro::thread_pool> tp,
+                                                 const std::vector<OMNI::Snapshot::StreamSnapshot> &pending,
+                                                 std::atomic<size_t> &next, std::atomic<size_t> &restored) {
+    co_await tp->schedule();
+    Handlers &handlers = Handlers::getInstance();
+    for (size_t i = next.fetch_add(1); i < pending.size(); i = next.fetch_add(1)) {
+        OMNI::Snapshot::StreamSnapshot stream = pending[i];
+        // RTP 时间戳按停机时长推进，接收端看到的是一段空白而不是时间倒退
+        const int64_t elapsed_ms = std::max<int64_t>(0, now_milliseconds() - stream.saved_at());
+        stream.set_rtp_timestamp(stream.rtp_timestamp() + static_cast<uint32_t>(elapsed_ms * 48));
+
+        // 启动成功时 remember 会移除 carried_ 中的记录，失败的记录留到下一次快照
+        auto res = Handlers::get_res("", stream.stream_id());
+        handlers.startStreamHandler(&stream.start(), res, &stream);
+        if (res.code() == OMNI::SUCCESS) {
+            restored.fetch_add(1);
+        } else {
+            LOG(WARNING) << "[SnapshotManager] 恢复流 " << stream.stream_id() << " 失败，保留在快照中: "
+                         << res.message();
+        }
+    }
+}
@@ -0,0 +1,66 @@
+// SnapshotManager.h
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <coro/coro.hpp>
+#include "Stream.pb.h"
+#include "Snapshot.pb.h"
+
+/**
+ * @brief 流状态快照与热重启
+ *        定期把每条流的启动参数、播放列表、当前曲目、播放模式与洗牌种子、播放位置、音量、播放状态和 RTP 时间戳
+ *        写入本地的 protobuf 文件（先写临时文件再 rename，不会留下半个快照）。
+ *        以 --restore 启动时读取快照，用有限数量的协程在线程池上并行重建所有流，并跳回各自保存的位置。
+ *        启动时快照中的记录先全部保留（未开启 --restore 或恢复失败的也一样），之后每次保存原样带上，
+ *        直到同名的流重新启动或被 StopStream 显式移除，避免一次失败的恢复就永久丢失状态。
+ */
+class SnapshotManager {
+public:
+    static SnapshotManager &getInstance() {
+        static SnapshotManager instance;
+        return instance;
+    }
+
+    SnapshotManager(const SnapshotManager &) = delete;
+
+    SnapshotManager &operator=(const SnapshotManager &) = delete;
+
+    // 记录流的启动参数，流退出时 forget
+    void remember(const std::string &stream_id, const OMNI::Instance::StartStreamPayload &payload);
+
+    void forget(const std::string &stream_id);
+
+    // 丢弃快照中尚未恢复的记录，存在时返回 true
+    bool discard(const std::string &stream_id);
+
+    // 读取快照文件中的全部记录，之后的保存会带上其中尚未恢复的部分；返回记录数
+    size_t load();
+
+    // 立即写一次快照，失败时返回 false
+    bool save();
+
+    // 每 interval 写一次快照
+    coro::task<void> run(std::shared_ptr<coro::io_scheduler> scheduler, std::chrono::seconds interval);
+
+    // 恢复 load 读到的所有记录，最多 concurrency 条同时启动，返回成功恢复的数量；失败的记录继续保留
+    coro::task<size_t> restore(std::shared_ptr<coro::thread_pool> tp, size_t concurrency);
+
+private:
+    SnapshotManager() = default;
+
+    ~SnapshotManager() = default;
+
+    coro::task<void> restore_worker(std::shared_ptr<coro::thread_pool> tp,
+                                    const std::vector<OMNI::Snapshot::StreamSnapshot> &pending,
+                                    std::atomic<size_t> &next, std::atomic<size_t> &restored);
+
+    std::mutex mutex_; // 保护 payloads_ 与 carried_
+    std::unordered_map<std::string, OMNI::Instance::StartStreamPayload> payloads_;
+    std::unordered_map<std::string, OMNI::Snapshot::StreamSnapshot> carried_; // 快照中尚未恢复的记录
+};
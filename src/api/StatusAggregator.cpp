@@ -0,0 +1,73 @@
+#include "StatusAggregator.h"
+#include "EventPublisher.h"
+#include "handlers/Handlers.h"
+
+void StatusAggregator::mark_dirty(const std::string &stream_id) {
+    mark(dirty_streams_, stream_id);
+}
+
+void StatusAggregator::mark_playlist_dirty(const std::string &stream_id) {
+    mark(dirty_play_lists_, stream_id);
+}
+
+void StatusAggregator::mark(std::unordered_set<std::string> &set, const std::string &stream_id) {
+    bool first;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first = dirty_streams_.empty() && dirty_play_lists_.empty();
+        set.insert(stream_id);
+    }
+    if (first) {
+        EventPublisher::getInstance().notify_status();
+    }
+}
+
+bool StatusAggregator::collect(OMNI::StatusDelta &delta) {
+    std::unordered_set<std::string> streams;
+    std::unordered_set<std::string> play_lists;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        streams.swap(dirty_streams_);
+        play_lists.swap(dirty_play_lists_);
+    }
+    if (streams.empty() && play_lists.empty()) {
+        return false;
+    }
+
+    Handlers &handlers = Handlers::getInstance();
+    std::unordered_set<std::string> removed;
+
+    for (const auto &stream_id: streams) {
+        OMNI::Instance::GetStreamPayload payload;
+        auto res = Handlers::get_res("", stream_id);
+        handlers.getStreamHandler(&payload, res);
+        if (res.code() == OMNI::NOT_FOUND) {
+            removed.insert(stream_id);
+            continue;
+        }
+        auto *item = delta.add_streams();
+        if (res.has_get_stream_response()) {
+            item->Swap(res.mutable_get_stream_response());
+        } else {
+            // 流存在但当前没有任务，只带上 ID
+            item->set_stream_id(stream_id);
+        }
+    }
+
+    // 播放列表只带长度：完整顺序可能有上千项，订阅方需要时再发 GetPlayList
+    for (const auto &stream_id: play_lists) {
+        auto manager = StreamRegistry::getInstance().find(stream_id);
+        if (!manager) {
+            removed.insert(stream_id);
+            continue;
+        }
+        auto *play_list = delta.add_play_lists();
+        play_list->set_stream_id(stream_id);
+        play_list->set_total(static_cast<uint32_t>(manager->getTaskCount()));
+    }
+
+    for (const auto &stream_id: removed) {
+        delta.add_removed_stream_ids(stream_id);
+    }
+    return true;
+}
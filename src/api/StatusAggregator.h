@@ -0,0 +1,46 @@
+// StatusAggregator.h
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include "Response.pb.h"
+
+/**
+ * @brief 流状态事件聚合器
+ *        开始/结束曲目、播放列表更新、音量调整等只把流标记为脏，不再各自立即组装并发送 GetStreamResponse。
+ *        每个聚合周期由 EventPublisher 在线程池上取走脏集合，合成一条 StatusDelta 发出，
+ *        周期内同一个流的多次变化只发一次。mark_* 可在任意线程调用。
+ */
+class StatusAggregator {
+public:
+    static StatusAggregator &getInstance() {
+        static StatusAggregator instance;
+        return instance;
+    }
+
+    StatusAggregator(const StatusAggregator &) = delete;
+
+    StatusAggregator &operator=(const StatusAggregator &) = delete;
+
+    // 播放位置、状态或当前曲目发生变化
+    void mark_dirty(const std::string &stream_id);
+
+    // 播放列表发生变化
+    void mark_playlist_dirty(const std::string &stream_id);
+
+    // 取走当前的脏集合并填充增量，没有任何变化时返回 false；会调用各流的查询处理，不要在反应器线程调用
+    bool collect(OMNI::StatusDelta &delta);
+
+private:
+    StatusAggregator() = default;
+
+    ~StatusAggregator() = default;
+
+    // 集合从空变为非空时唤醒反应器，开始一个聚合周期
+    void mark(std::unordered_set<std::string> &set, const std::string &stream_id);
+
+    std::mutex mutex_; // 保护两个脏集合
+    std::unordered_set<std::string> dirty_streams_;
+    std::unordered_set<std::string> dirty_play_lists_;
+};
@@ -0,0 +1,22 @@
+#include "StreamRegistry.h"
+#include "../DownloadManager/DownloadManager.h"
+
+bool StreamRegistry::add(const std::string &stream_id, std::shared_ptr<DownloadManager> manager) {
+    if (!manager) {
+        return false;
+    }
+    return instances_.try_emplace(stream_id, std::move(manager)).second;
+}
+
+std::shared_ptr<DownloadManager> StreamRegistry::find(const std::string &stream_id) const {
+    auto it = instances_.find(stream_id);
+    return it != instances_.cend() ? it->second : nullptr;
+}
+
+bool StreamRegistry::remove(const std::string &stream_id, const DownloadManager *expected) {
+    auto current = find(stream_id);
+    if (!current || current.get() != expected) {
+        return false;
+    }
+    return instances_.erase_if_equal(stream_id, current) > 0;
+}
@@ -0,0 +1,51 @@
+// StreamRegistry.h
+#pragma once
+
+#include <memory>
+#include <string>
+#include <folly/concurrency/ConcurrentHashMap.h>
+
+class DownloadManager;
+
+/**
+ * @brief 流实例注册表，替代原先无锁保护的 Handlers::instanceMap
+ *        按 stream_id 直接索引，流移除后表项随之删除，不保留任何历史 id。
+ *        使用 folly::ConcurrentHashMap：内部按分片加锁写入，读取无等待，ZMQ 线程与线程池可以同时访问。
+ *        实例由 shared_ptr 共同持有，移除后查找方手里的引用依然有效，最后一个持有者负责析构。
+ */
+class StreamRegistry {
+public:
+    static StreamRegistry &getInstance() {
+        static StreamRegistry instance;
+        return instance;
+    }
+
+    StreamRegistry(const StreamRegistry &) = delete;
+
+    StreamRegistry &operator=(const StreamRegistry &) = delete;
+
+    // 登记实例，stream_id 已有实例时返回 false 且不替换
+    bool add(const std::string &stream_id, std::shared_ptr<DownloadManager> manager);
+
+    [[nodiscard]] std::shared_ptr<DownloadManager> find(const std::string &stream_id) const;
+
+    // 只有当前登记的仍是 expected 时才移除，避免旧实例退出时误删同名的新实例
+    bool remove(const std::string &stream_id, const DownloadManager *expected);
+
+    [[nodiscard]] size_t size() const { return instances_.size(); }
+
+    // 遍历当前所有实例，遍历期间其他线程可以继续增删
+    template<typename Fn>
+    void forEach(Fn &&fn) const {
+        for (const auto &[stream_id, manager]: instances_) {
+            fn(stream_id, manager);
+        }
+    }
+
+private:
+    StreamRegistry() = default;
+
+    ~StreamRegistry() = default;
+
+    folly::ConcurrentHashMap<std::string, std::shared_ptr<DownloadManager>> instances_;
+};
@@ -0,0 +1,45 @@
+#include "StreamStrands.h"
+#include <glog/logging.h>
+
+StreamStrands::StreamStrands(std::shared_ptr<coro::thread_pool> tp)
+        : tp_(std::move(tp)), container_(tp_) {}
+
+void StreamStrands::post(const std::string &key, Job job) {
+    std::shared_ptr<Strand> strand;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = strands_.find(key);
+        if (it != strands_.end()) {
+            // 已有任务在执行，排在后面由同一个 drain 处理
+            it->second->jobs.push_back(std::move(job));
+            return;
+        }
+        strand = std::make_shared<Strand>();
+        strand->jobs.push_back(std::move(job));
+        strands_.emplace(key, strand);
+    }
+    container_.start(drain(key, std::move(strand)));
+    container_.garbage_collect();
+}
+
+coro::task<void> StreamStrands::drain(std::string key, std::shared_ptr<Strand> strand) {
+    co_await tp_->schedule();
+    while (true) {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (strand->jobs.empty()) {
+                strands_.erase(key);
+                break;
+            }
+            job = std::move(strand->jobs.front());
+            strand->jobs.pop_front();
+        }
+        try {
+            job();
+        } catch (const std::exception &e) {
+            LOG(ERROR) << "[StreamStrands] 处理流 " << key << " 的请求时出错: " << e.what();
+        }
+    }
+    co_return;
+}
@@ -0,0 +1,40 @@
+// StreamStrands.h
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <coro/coro.hpp>
+
+/**
+ * @brief 按 stream_id 划分的串行执行队列
+ *        同一个流的请求按投递顺序在线程池上逐个执行，不同流的请求互不等待。
+ *        某个 key 没有待执行的任务时不占用任何资源，下次投递时重新创建。post 可在任意线程调用。
+ */
+class StreamStrands {
+public:
+    using Job = std::function<void()>;
+
+    explicit StreamStrands(std::shared_ptr<coro::thread_pool> tp);
+
+    StreamStrands(const StreamStrands &) = delete;
+
+    StreamStrands &operator=(const StreamStrands &) = delete;
+
+    void post(const std::string &key, Job job);
+
+private:
+    struct Strand {
+        std::deque<Job> jobs; // 只在 mutex_ 下访问；strand 在 strands_ 中即表示正在执行
+    };
+
+    coro::task<void> drain(std::string key, std::shared_ptr<Strand> strand);
+
+    std::shared_ptr<coro::thread_pool> tp_;
+    coro::task_container<coro::thread_pool> container_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<Strand>> strands_;
+};
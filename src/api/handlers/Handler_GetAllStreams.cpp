@@ -0,0 +1,32 @@
+#include "Handlers.h"
+
+void Handlers::getAllStreamsHandler(const GetAllStreamsRequest *data, OMNI::Response &res) {
+    auto &registry = StreamRegistry::getInstance();
+    FleetSnapshot *snapshot = res.mutable_fleet_snapshot();
+
+    // 流数量只是预估，遍历期间仍可能增减
+    const int expected = static_cast<int>(registry.size());
+    snapshot->mutable_stream_ids()->Reserve(expected);
+    snapshot->mutable_time_played()->Reserve(expected);
+    snapshot->mutable_time_total()->Reserve(expected);
+    snapshot->mutable_play_state()->Reserve(expected);
+    snapshot->mutable_volume()->Reserve(expected);
+    snapshot->mutable_bitrate()->Reserve(expected);
+    snapshot->mutable_pcm_fill()->Reserve(expected);
+    snapshot->mutable_packet_fill()->Reserve(expected);
+    snapshot->mutable_underruns()->Reserve(expected);
+
+    registry.forEach([snapshot](const std::string &, const std::shared_ptr<DownloadManager> &manager) {
+        auto sender = manager->get_audio_sender();
+        const auto &stats = sender->stats();
+        snapshot->add_stream_ids(sender->stream_id_);
+        snapshot->add_time_played(stats.time_played_ms.load(std::memory_order_relaxed));
+        snapshot->add_time_total(stats.time_total_ms.load(std::memory_order_relaxed));
+        snapshot->add_play_state(static_cast<OMNI::PlayState>(stats.play_state.load(std::memory_order_relaxed)));
+        snapshot->add_volume(stats.volume.load(std::memory_order_relaxed));
+        snapshot->add_bitrate(stats.bitrate.load(std::memory_order_relaxed));
+        snapshot->add_pcm_fill(sender->pcmFill());
+        snapshot->add_packet_fill(sender->packetFill());
+        snapshot->add_underruns(stats.underruns.load(std::memory_order_relaxed));
+    });
+}
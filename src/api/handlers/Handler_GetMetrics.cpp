@@ -0,0 +1,144 @@
+#include "Handlers.h"
+#include <cstdio>
+
+namespace {
+    struct StreamMetricsRow {
+        std::string labels; // 已转义的 {stream_id="..."}
+        std::array<uint64_t, StreamMetrics::CounterCount> counters{};
+        std::array<StreamMetrics::HistogramSnapshot, StreamMetrics::HistogramCount> histograms{};
+        uint64_t underruns = 0;
+        float pcm_fill = 0;
+        float packet_fill = 0;
+    };
+
+    // 标签值需要转义反斜杠、双引号和换行
+    std::string make_labels(const std::string &stream_id) {
+        std::string labels = "{stream_id=\"";
+        for (char c: stream_id) {
+            if (c == '\\' || c == '"') {
+                labels += '\\';
+                labels += c;
+            } else if (c == '\n') {
+                labels += "\\n";
+            } else {
+                labels += c;
+            }
+        }
+        labels += "\"}";
+        return labels;
+    }
+
+    std::string format_double(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    void write_header(std::string &out, const char *name, const char *type, const char *help) {
+        out += "# HELP ";
+        out += name;
+        out += ' ';
+        out += help;
+        out += "\n# TYPE ";
+        out += name;
+        out += ' ';
+        out += type;
+        out += '\n';
+    }
+
+    template<typename Getter>
+    void write_family(std::string &out, const std::vector<StreamMetricsRow> &rows, const char *name,
+                      const char *type, const char *help, Getter &&getter) {
+        write_header(out, name, type, help);
+        for (const auto &row: rows) {
+            out += name;
+            out += row.labels;
+            out += ' ';
+            out += getter(row);
+            out += '\n';
+        }
+    }
+
+    // 微秒直方图按 Prometheus 约定以秒输出，桶计数累加
+    void write_histogram(std::string &out, const std::vector<StreamMetricsRow> &rows, const char *name,
+                         const char *help, StreamMetrics::Histogram histogram) {
+        write_header(out, name, "histogram", help);
+        const std::string base = name;
+        for (const auto &row: rows) {
+            const auto &snapshot = row.histograms[histogram];
+            // 去掉 labels 末尾的 '}'，之后追加 le 标签
+            const std::string prefix = base + "_bucket" + row.labels.substr(0, row.labels.size() - 1) + ",le=\"";
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < StreamMetrics::BUCKET_COUNT; ++i) {
+                cumulative += snapshot.buckets[i];
+                out += prefix;
+                out += i < StreamMetrics::BUCKET_BOUNDS_US.size()
+                       ? format_double(static_cast<double>(StreamMetrics::BUCKET_BOUNDS_US[i]) / 1e6)
+                       : "+Inf";
+                out += "\"} ";
+                out += std::to_string(cumulative);
+                out += '\n';
+            }
+            out += base + "_sum" + row.labels + ' ' + format_double(static_cast<double>(snapshot.sum_us) / 1e6) + '\n';
+            out += base + "_count" + row.labels + ' ' + std::to_string(snapshot.count) + '\n';
+        }
+    }
+}
+
+void Handlers::getMetricsHandler(const GetMetricsRequest *data, OMNI::Response &res) {
+    // 先合并各流的分片，再按指标分组输出：Prometheus 要求同名指标连续出现
+    std::vector<StreamMetricsRow> rows;
+    rows.reserve(StreamRegistry::getInstance().size());
+    StreamRegistry::getInstance().forEach([&rows](const std::string &, const std::shared_ptr<DownloadManager> &manager) {
+        auto sender = manager->get_audio_sender();
+        const auto &metrics = sender->metrics();
+        auto &row = rows.emplace_back();
+        row.labels = make_labels(sender->stream_id_);
+        for (int i = 0; i < StreamMetrics::CounterCount; ++i) {
+            row.counters[i] = metrics.counter(static_cast<StreamMetrics::Counter>(i));
+        }
+        for (int i = 0; i < StreamMetrics::HistogramCount; ++i) {
+            row.histograms[i] = metrics.histogram(static_cast<StreamMetrics::Histogram>(i));
+        }
+        row.underruns = sender->stats().underruns.load(std::memory_order_relaxed);
+        row.pcm_fill = sender->pcmFill();
+        row.packet_fill = sender->packetFill();
+    });
+
+    std::string out;
+    out.reserve(256 + rows.size() * 2048);
+
+    write_header(out, "voice_streams", "gauge", "Number of running streams.");
+    out += "voice_streams " + std::to_string(rows.size()) + '\n';
+
+    auto counter = [](StreamMetrics::Counter which) {
+        return [which](const StreamMetricsRow &row) { return std::to_string(row.counters[which]); };
+    };
+    write_family(out, rows, "voice_download_bytes_total", "counter",
+                 "Bytes received from the audio source.", counter(StreamMetrics::DownloadedBytes));
+    write_family(out, rows, "voice_decode_bytes_total", "counter",
+                 "Bytes produced by the decode stage: PCM when transcoding, Opus payload in passthrough.",
+                 counter(StreamMetrics::DecodedBytes));
+    write_family(out, rows, "voice_passthrough_bytes_total", "counter",
+                 "Opus payload bytes forwarded without transcoding (included in voice_decode_bytes_total).",
+                 counter(StreamMetrics::PassthroughBytes));
+    write_family(out, rows, "voice_frames_encoded_total", "counter",
+                 "Opus frames encoded.", counter(StreamMetrics::FramesEncoded));
+    write_family(out, rows, "voice_frames_sent_total", "counter",
+                 "Opus frames sent over RTP.", counter(StreamMetrics::FramesSent));
+    write_family(out, rows, "voice_frames_late_total", "counter",
+                 "Frames skipped because sending fell behind real time.", counter(StreamMetrics::FramesLate));
+    write_family(out, rows, "voice_underruns_total", "counter",
+                 "Times the sender was due but had no packet to send.",
+                 [](const StreamMetricsRow &row) { return std::to_string(row.underruns); });
+    write_family(out, rows, "voice_pcm_ring_fill", "gauge", "PCM ring buffer fill ratio.",
+                 [](const StreamMetricsRow &row) { return format_double(row.pcm_fill); });
+    write_family(out, rows, "voice_packet_ring_fill", "gauge", "Encoded packet ring buffer fill ratio.",
+                 [](const StreamMetricsRow &row) { return format_double(row.packet_fill); });
+    write_histogram(out, rows, "voice_encode_frame_seconds", "Time spent encoding one Opus frame.",
+                    StreamMetrics::EncodeTime);
+    write_histogram(out, rows, "voice_send_lateness_seconds", "How late each send was against its schedule.",
+                    StreamMetrics::SendLateness);
+
+    res.mutable_metrics()->set_text(std::move(out));
+}
@@ -38,4 +38,5 @@ void Handlers::getStreamHandler(const Instance::GetStreamPayload *data, OMNI::Re
     res_data->set_play_state(static_cast<OMNI::PlayState>(props.play_state));
     res_data->set_volume(props.volume);
     res_data->set_play_mode(static_cast<OMNI::ConsumerMode>(target->getMode()));
+    res_data->set_shuffle_seed(target->getShuffleSeed());
 }
@@ -22,6 +22,7 @@ void Handlers::getPlayListHandler(const Instance::GetPlayListPayload *data, OMNI
     try {
         auto order = target->getTaskOrder();
         play_list->mutable_order_list()->Add(order.begin(), order.end());
+        play_list->set_total(static_cast<uint32_t>(order.size()));
     } catch (const std::exception &e) {
         res.set_code(OMNI::ERROR);
         res.set_message(std::string("获取任务顺序时发生错误: ") + e.what());
@@ -65,4 +66,61 @@ void Handlers::updatePlayListHandler(const Instance::UpdatePlayListPayload *data
     // 获取更新后的任务顺序并添加到 PlayListResponse 中
     auto updatedOrder = target->getTaskOrder();
     play_list->mutable_order_list()->Add(updatedOrder.begin(), updatedOrder.end());
+    play_list->set_total(static_cast<uint32_t>(updatedOrder.size()));
+}
+
+void Handlers::patchPlayListHandler(const Instance::PatchPlayListPayload *data, OMNI::Response &res) {
+    auto streamId = res.stream_id();
+    auto targetOpt = findById(streamId);
+    if (!targetOpt.has_value()) {
+        res.set_code(OMNI::NOT_FOUND);
+        res.set_message("PatchPlayList: 未找到对应 ID 的流");
+        return;
+    }
+    auto target = targetOpt.value();
+
+    auto to_tasks = [](const auto &items) {
+        std::vector<TaskItem> tasks;
+        tasks.reserve(items.size());
+        for (const auto &order: items) {
+            tasks.push_back(OrderItem2Task(order));
+        }
+        return tasks;
+    };
+
+    for (int i = 0; i < data->ops_size(); ++i) {
+        const auto &op = data->ops(i);
+        bool ok = true;
+        switch (op.op_case()) {
+            case Instance::PlayListOp::kAppend:
+                ok = target->appendTasks(to_tasks(op.append().items()));
+                break;
+            case Instance::PlayListOp::kInsertAfter:
+                ok = target->insertTasksAfter(op.insert_after().anchor_id(), to_tasks(op.insert_after().items()));
+                break;
+            case Instance::PlayListOp::kMove:
+                ok = target->moveTaskAfter(op.move().task_id(), op.move().anchor_id());
+                break;
+            case Instance::PlayListOp::kRemove:
+                for (const auto &task_id: op.remove().task_ids()) {
+                    ok = target->removeTask(task_id) && ok;
+                }
+                break;
+            case Instance::PlayListOp::kShuffleSeed:
+                target->setShuffleSeed(op.shuffle_seed().seed());
+                break;
+            case Instance::PlayListOp::OP_NOT_SET:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            res.set_code(OMNI::ERROR);
+            res.set_message("PatchPlayList: 第 " + std::to_string(i) + " 个操作失败（ID 不存在或重复）");
+            break;
+        }
+    }
+
+    PlayListResponse *play_list = res.mutable_play_list_response();
+    play_list->set_stream_id(streamId);
+    play_list->set_total(static_cast<uint32_t>(target->getTaskCount()));
 }
@@ -1,7 +1,10 @@
 #include "Handlers.h"
 #include "../../RTPManager/RTPManager.h"
+#include "../SnapshotManager.h"
+#include "../StatusAggregator.h"
 
-void Handlers::startStreamHandler(const Instance::StartStreamPayload *data, OMNI::Response &res) {
+void Handlers::startStreamHandler(const Instance::StartStreamPayload *data, OMNI::Response &res,
+                                  const Snapshot::StreamSnapshot *resume) {
     // 创建协程任务
     const auto &stream_info = data->stream_info();
     auto streamInfo = ChannelJoinedData{
@@ -11,30 +14,39 @@ void Handlers::startStreamHandler(const Instance::StartStreamPayload *data, OMNI
             stream_info.audio_ssrc(),
             stream_info.audio_pt(),
             stream_info.bitrate(),
-            stream_info.rtcp_mux()
+            stream_info.rtcp_mux(),
+            stream_info.frame_duration(),
+            stream_info.frames_per_packet()
     };
     auto stream_id = res.stream_id();
 
+    auto &registry = StreamRegistry::getInstance();
+    if (registry.find(stream_id)) {
+        LOG(WARNING) << "流 " << stream_id << " 已存在";
+        res.set_code(OMNI::ERROR);
+        res.set_message("StartStream: 对应 ID 的流已存在");
+        return;
+    }
 
     int flags = RCE_SEND_ONLY;
 
     auto rtp_instance = RTPManager::getInstance().getRTPInstance(stream_id, streamInfo.ip);
 
-    auto stream_ = rtp_instance->createStream(stream_id, streamInfo, RTP_FORMAT_OPUS, flags);
-    if (stream_ == nullptr) {
-        LOG(ERROR) << "创建流失败";
-        res.set_code(OMNI::ERROR);
-        res.set_message("创建流失败。");
-        return;
-    }
-
     auto sender = std::make_shared<AudioSender>(stream_id, rtp_instance, tp, scheduler);
+    if (streamInfo.frame_duration != 0 && !sender->setFrameDuration(streamInfo.frame_duration)) {
+        LOG(WARNING) << "不支持的 Opus 帧时长 " << streamInfo.frame_duration << "ms，使用默认值";
+    }
+    if (streamInfo.frames_per_packet > 1 && !sender->setFramesPerPacket(streamInfo.frames_per_packet)) {
+        LOG(WARNING) << "帧时长 " << sender->getFrameDuration() << "ms 下不支持每包 "
+                     << streamInfo.frames_per_packet << " 帧，不合并打包";
+    }
     sender->setOpusBitRate(streamInfo.bitrate);
+    sender->setComplexityPolicy(data->priority(), data->has_min_complexity() ? data->min_complexity() : 0);
     /*if (sender->is_initialized() == false) {
         LOG(ERROR) << "添加流请求失败";
         return;
     }*/
-    auto manager = new DownloadManager(tp, std::move(sender));
+    auto manager = std::make_shared<DownloadManager>(tp, std::move(sender));
 
     std::vector<TaskItem> newTasks;
     std::vector<std::string> newOrder;
@@ -50,13 +62,50 @@ void Handlers::startStreamHandler(const Instance::StartStreamPayload *data, OMNI
 
     manager->updateTasks(newTasks, newOrder);
 
-    const std::string &key = stream_id;
-    instanceMap[key] = manager;
-    // 设置移除自己的回调函数
-    manager->setRemoveCallback([this](const std::string &id) {
-        // 在 map 中移除该实例
-        instanceMap.erase(id);
-    }, key);
+    if (resume) {
+        // 先跳到快照中的曲目再切换模式，随机模式会把它记为本轮已播
+        if (!resume->current_task_id().empty() && manager->skipTo(resume->current_task_id())) {
+            manager->hasManualSkip = false;
+        }
+        manager->restoreShuffleState({
+                .seed = resume->shuffle_seed(),
+                .cycle = resume->shuffle_cycle(),
+                .played = {resume->shuffle_played().begin(), resume->shuffle_played().end()},
+                .history = {resume->shuffle_history().begin(), resume->shuffle_history().end()}
+        });
+        manager->setMode(static_cast<::ConsumerMode>(resume->play_mode()));
+        manager->get_audio_sender()->restoreState(resume->volume(), static_cast<::PlayState>(resume->play_state()),
+                                                  static_cast<int>(resume->time_played() / 1000),
+                                                  resume->rtp_timestamp());
+    }
+
+    // 设置移除自己的回调函数，只移除自己，不影响之后以同一 ID 新建的流
+    manager->setRemoveCallback([raw = manager.get()](const std::string &id) {
+        if (StreamRegistry::getInstance().remove(id, raw)) {
+            SnapshotManager::getInstance().forget(id);
+            // 下一次状态推送中带上 removed_stream_ids
+            StatusAggregator::getInstance().mark_dirty(id);
+        }
+    }, stream_id);
+    // 先占住注册表中的位置再创建 RTP 流，并发的同名 StartStream 在这里落败，不会碰到已有流的 RTP 会话
+    if (!registry.add(stream_id, manager)) {
+        LOG(WARNING) << "流 " << stream_id << " 已存在";
+        res.set_code(OMNI::ERROR);
+        res.set_message("StartStream: 对应 ID 的流已存在");
+        return;
+    }
+
+    auto stream_ = rtp_instance->createStream(stream_id, streamInfo, RTP_FORMAT_OPUS, flags);
+    if (stream_ == nullptr) {
+        LOG(ERROR) << "创建流失败";
+        registry.remove(stream_id, manager.get());
+        RTPManager::getInstance().removeInstance(stream_id);
+        res.set_code(OMNI::ERROR);
+        res.set_message("创建流失败。");
+        return;
+    }
+
+    SnapshotManager::getInstance().remember(stream_id, *data);
 
     cleanup_task_container_.start(manager->initAndWaitJobs());
     cleanup_task_container_.garbage_collect();
@@ -2,11 +2,17 @@
 
 #include "Handlers.h"
 #include "../../RTPManager/RTPManager.h"
+#include "../SnapshotManager.h"
 
 void Handlers::stopStreamHandler(const Instance::RemoveStreamPayload *data, OMNI::Response &res) {
     auto streamId = res.stream_id();
     auto targetOpt = findById(streamId);
     if (!targetOpt.has_value()) {
+        if (SnapshotManager::getInstance().discard(streamId)) {
+            // 快照中尚未恢复的流：显式移除后不再写入之后的快照
+            res.set_message("StopStream: 已移除快照中未恢复的流");
+            return;
+        }
         res.set_code(OMNI::NOT_FOUND);
         res.set_message("StopSteam: 未找到对应 ID 的流");
         return;
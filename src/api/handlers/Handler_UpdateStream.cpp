@@ -12,7 +12,6 @@ void Handlers::updateStreamHandler(const Instance::UpdateStreamPayload *data, OM
     auto target = targetOpt.value();
 
     auto audio_sender = target->get_audio_sender();
-    auto using_decoder = audio_sender->using_decoder;
     auto &props = audio_sender->audio_props;
 
     // 处理不同的 payload 类型
@@ -3,9 +3,10 @@
 
 #include "HandlersBase.h"
 #include "../../DownloadManager/DownloadManager.h"
-#include <unordered_map>
+#include "../StreamRegistry.h"
 #include "Request.pb.h"
 #include "Response.pb.h"
+#include "Snapshot.pb.h"
 
 using namespace OMNI;
 
@@ -22,7 +23,9 @@ public:
     Handlers &operator=(const Handlers &) = delete;
 
     // 实现具体的处理函数
-    void startStreamHandler(const Instance::StartStreamPayload *data, OMNI::Response &res);
+    // resume 非空时按快照恢复播放位置、模式与状态（见 SnapshotManager）
+    void startStreamHandler(const Instance::StartStreamPayload *data, OMNI::Response &res,
+                            const Snapshot::StreamSnapshot *resume = nullptr);
 
     void stopStreamHandler(const Instance::RemoveStreamPayload *data, OMNI::Response &res);
 
@@ -34,10 +37,16 @@ public:
 
     void updatePlayListHandler(const Instance::UpdatePlayListPayload *data, OMNI::Response &res);
 
-    std::optional<DownloadManager *> findById(const std::string &id) {
-        auto it = instanceMap.find(id);
-        if (it != instanceMap.end()) {
-            return it->second;
+    void patchPlayListHandler(const Instance::PatchPlayListPayload *data, OMNI::Response &res);
+
+    void getAllStreamsHandler(const GetAllStreamsRequest *data, OMNI::Response &res);
+
+    void getMetricsHandler(const GetMetricsRequest *data, OMNI::Response &res);
+
+    // 返回的 shared_ptr 在处理期间保活实例，流即使同时退出也不会悬空
+    std::optional<std::shared_ptr<DownloadManager>> findById(const std::string &id) {
+        if (auto manager = StreamRegistry::getInstance().find(id)) {
+            return manager;
         }
         return {};
     }
@@ -60,6 +69,15 @@ public:
         return res;
     }
 
+    static TaskItem OrderItem2Task(const OrderItem &order) {
+        return TaskItem{
+                .name = order.task_id(),
+                .url = order.url(),
+                .type = static_cast<TaskType>(order.type()),
+                .use_stream = order.use_stream()
+        };
+    }
+
     static OrderItem_OrderType Task2OrderType(TaskType type) {
         switch (type) {
             case TaskType::File:
@@ -69,8 +87,6 @@ public:
         }
     }
 
-    std::unordered_map<std::string, DownloadManager *> instanceMap;
-
 private:
     Handlers() = default;
 
@@ -5,6 +5,8 @@
 #include <glog/logging.h>
 
 #include "api/EventPublisher.h"
+#include "api/SnapshotManager.h"
+#include "api/StatusAggregator.h"
 #include "api/handlers/Handlers.h"
 #include "DownloadManager/AudioSender/AudioSender.h"
 #include "RTPManager/RTPManager.h"
@@ -34,7 +36,7 @@ void createStreamAndManageTasks(const std::string &stream_id, const std::string
     // Create AudioSender and DownloadManager
     std::unique_ptr<AudioSender> sender = std::make_unique<AudioSender>(stream_id, rtp_instance, handlers.tp,
                                                                         handlers.scheduler);
-    auto manager = new DownloadManager(handlers.tp, std::move(sender));
+    auto manager = std::make_shared<DownloadManager>(handlers.tp, std::move(sender));
 
     // Add download tasks dynamically from the task list
     int taskIndex = 1;
@@ -48,7 +50,16 @@ void createStreamAndManageTasks(const std::string &stream_id, const std::string
     }
 
     // Manage tasks
-    handlers.instanceMap.emplace(stream_id, manager);
+    auto &registry = StreamRegistry::getInstance();
+    manager->setRemoveCallback([raw = manager.get()](const std::string &id) {
+        if (StreamRegistry::getInstance().remove(id, raw)) {
+            StatusAggregator::getInstance().mark_dirty(id);
+        }
+    }, stream_id);
+    if (!registry.add(stream_id, manager)) {
+        LOG(INFO) << "Stream " << stream_id << " already exists";
+        return;
+    }
     handlers.cleanup_task_container_.start(manager->initAndWaitJobs());
 }
 
@@ -120,9 +131,20 @@ int main(int argc, char *argv[]) {
                                        "http://172.20.240.1:3000/plugin/url/NETEASE:2612421551",*/
                                });
 #endif
-    while (true) {
-        publisher.handle_request_response();
+    SnapshotManager &snapshots = SnapshotManager::getInstance();
+    // 不恢复时也先读入旧快照，其中的记录会被带到之后的快照里，不会被第一次保存覆盖
+    snapshots.load();
+    if (config.restore) {
+        // 在开始处理请求前恢复，编排端不会看到半恢复的节点
+        coro::sync_wait(snapshots.restore(handlers.tp, static_cast<size_t>(std::max(1, config.restore_concurrency))));
     }
+    if (config.snapshot_interval_s > 0) {
+        handlers.cleanup_task_container_.start(
+                snapshots.run(handlers.scheduler, std::chrono::seconds(config.snapshot_interval_s)));
+    }
+
+    // 阻塞在 zmq::poll 上处理请求与出站事件，空闲时不占用 CPU
+    publisher.run();
 
     mpg123_exit();
     return 0;